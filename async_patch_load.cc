@@ -0,0 +1,76 @@
+#include "async_patch_load.hh"
+#include "ryml/ryml_init.hh"
+
+namespace MetaModule
+{
+
+namespace
+{
+
+struct ProgressContext {
+	std::stop_token stop;
+	AsyncPatchLoad::ProgressCallback const &on_progress;
+	PatchLoadOptions const &options;
+	bool cancelled = false;
+};
+
+bool report_progress(PatchLoadProgress const &progress, void *context) {
+	auto &ctx = *static_cast<ProgressContext *>(context);
+
+	if (!ctx.stop.stop_requested()) {
+		if (ctx.on_progress)
+			ctx.on_progress(progress);
+
+		bool keep_going =
+			!ctx.options.on_progress || ctx.options.on_progress(progress, ctx.options.progress_context);
+
+		if (keep_going && !ctx.stop.stop_requested())
+			return true;
+	}
+
+	ctx.cancelled = true;
+	return false;
+}
+
+} // namespace
+
+AsyncPatchLoad::AsyncPatchLoad(std::string yaml, ProgressCallback on_progress, PatchLoadOptions options)
+	: yaml{std::move(yaml)}
+	, on_progress{std::move(on_progress)}
+	, options{options} {
+	// ryml's global callbacks are set up here, on the caller's thread, so loaders
+	// running in parallel don't race to initialize them
+	RymlInit::init_once();
+
+	worker = std::jthread{[this](std::stop_token stop) { run(stop); }};
+}
+
+AsyncPatchLoad::~AsyncPatchLoad() {
+	cancel();
+	// worker joins when it's destroyed
+}
+
+void AsyncPatchLoad::cancel() {
+	worker.request_stop();
+}
+
+AsyncPatchLoad::Status AsyncPatchLoad::wait() const {
+	status_.wait(Status::Loading, std::memory_order_acquire);
+	return status();
+}
+
+void AsyncPatchLoad::run(std::stop_token stop) {
+	ProgressContext ctx{stop, on_progress, options};
+
+	auto load_options = options;
+	load_options.on_progress = report_progress;
+	load_options.progress_context = &ctx;
+
+	bool ok = yaml_raw_to_patch(yaml, pd, load_options);
+
+	Status result = ok ? Status::Done : ctx.cancelled ? Status::Cancelled : Status::Failed;
+	status_.store(result, std::memory_order_release);
+	status_.notify_all();
+}
+
+} // namespace MetaModule
@@ -0,0 +1,63 @@
+#pragma once
+#include "patch/patch_data.hh"
+#include "yaml_to_patch.hh"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace MetaModule
+{
+
+// Loads a patch on a worker thread, so the caller is never blocked by a large file
+// (host builds only).
+//
+// The yaml is parsed on the loader's own thread. Poll status() or block in wait(), then
+// read the result with patch(). cancel() stops the load before the next section: the
+// parse itself can't be interrupted, but nothing after it runs. Destroying the loader
+// cancels it and waits for the thread.
+class AsyncPatchLoad {
+public:
+	enum class Status { Loading, Done, Failed, Cancelled };
+
+	// Called on the worker thread, before parsing and before each section
+	using ProgressCallback = std::function<void(PatchLoadProgress const &)>;
+
+	// options.on_progress, if set, is also called and may cancel the load.
+	// With options.retain_source, the patch refers into the loader's copy of the
+	// yaml, so the loader must outlive any use of patch().
+	explicit AsyncPatchLoad(std::string yaml, ProgressCallback on_progress = {}, PatchLoadOptions options = {});
+
+	AsyncPatchLoad(AsyncPatchLoad const &) = delete;
+	AsyncPatchLoad &operator=(AsyncPatchLoad const &) = delete;
+
+	~AsyncPatchLoad();
+
+	void cancel();
+
+	Status status() const {
+		return status_.load(std::memory_order_acquire);
+	}
+
+	// Blocks until the load finishes, fails, or is cancelled
+	Status wait() const;
+
+	// Only valid once status() is Done
+	PatchData &patch() {
+		return pd;
+	}
+
+private:
+	void run(std::stop_token stop);
+
+	std::string yaml;
+	ProgressCallback on_progress;
+	PatchLoadOptions options;
+	PatchData pd;
+	std::atomic<Status> status_{Status::Loading};
+
+	// Declared last, so everything the thread uses exists before it starts
+	std::jthread worker;
+};
+
+} // namespace MetaModule
@@ -1,32 +1,392 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
 #include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 
-#include "ryml.hpp"
-#include "ryml_init.hh"
+// Base64 kernels are written with GCC/Clang vector extensions, which compile to SSE on x86
+// and NEON on ARM. Define METAMODULE_BASE64_SCALAR to force the portable scalar code.
+#if !defined(METAMODULE_BASE64_SCALAR) && defined(__GNUC__) && defined(__BYTE_ORDER__) &&                            \
+	(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define METAMODULE_BASE64_VECTOR 1
+#else
+#define METAMODULE_BASE64_VECTOR 0
+#endif
 
 namespace MetaModule
 {
+
+namespace Base64Detail
+{
+
+constexpr char encode_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+enum : uint8_t { Whitespace = 0x80, Pad = 0x81, Invalid = 0xFF };
+
+struct DecodeTable {
+	uint8_t v[256];
+
+	constexpr DecodeTable()
+		: v{} {
+		for (auto &x : v)
+			x = Invalid;
+		for (uint8_t i = 0; i < 64; i++)
+			v[static_cast<uint8_t>(encode_table[i])] = i;
+		v[' '] = v['\t'] = v['\n'] = v['\r'] = Whitespace;
+		v['='] = Pad;
+	}
+};
+
+constexpr DecodeTable decode_table{};
+
+// Decoding state, carried across calls so input may contain line breaks
+// or be split at any point.
+struct DecodeState {
+	uint32_t acc = 0;
+	uint8_t count = 0;
+	uint8_t pad = 0;
+	bool error = false;
+};
+
+inline void encode_scalar(const uint8_t *src, size_t len, char *dst) {
+	size_t i = 0;
+	for (; i + 3 <= len; i += 3) {
+		uint32_t v = (uint32_t(src[i]) << 16) | (uint32_t(src[i + 1]) << 8) | src[i + 2];
+		*dst++ = encode_table[v >> 18];
+		*dst++ = encode_table[(v >> 12) & 0x3F];
+		*dst++ = encode_table[(v >> 6) & 0x3F];
+		*dst++ = encode_table[v & 0x3F];
+	}
+
+	if (len - i == 1) {
+		uint32_t v = uint32_t(src[i]) << 16;
+		*dst++ = encode_table[v >> 18];
+		*dst++ = encode_table[(v >> 12) & 0x3F];
+		*dst++ = '=';
+		*dst++ = '=';
+	} else if (len - i == 2) {
+		uint32_t v = (uint32_t(src[i]) << 16) | (uint32_t(src[i + 1]) << 8);
+		*dst++ = encode_table[v >> 18];
+		*dst++ = encode_table[(v >> 12) & 0x3F];
+		*dst++ = encode_table[(v >> 6) & 0x3F];
+		*dst++ = '=';
+	}
+}
+
+// Decodes chars into dst, writing at most dst_len bytes. Returns the number of bytes written.
+// Stops and sets state.error on an invalid char, or if dst is full.
+inline size_t decode_scalar(DecodeState &state, const char *src, size_t src_len, uint8_t *dst, size_t dst_len) {
+	auto *out = dst;
+	auto *end = dst + dst_len;
+	for (size_t i = 0; i < src_len; i++) {
+		auto v = decode_table.v[static_cast<uint8_t>(src[i])];
+		if (v < 64) {
+			if (state.pad) {
+				state.error = true;
+				break;
+			}
+			state.acc = (state.acc << 6) | v;
+			if (++state.count == 4) {
+				if (end - out < 3) {
+					state.error = true;
+					break;
+				}
+				*out++ = state.acc >> 16;
+				*out++ = (state.acc >> 8) & 0xFF;
+				*out++ = state.acc & 0xFF;
+				state.acc = 0;
+				state.count = 0;
+			}
+		} else if (v == Whitespace) {
+			continue;
+		} else if (v == Pad && state.count + state.pad >= 2 && state.count + state.pad < 4) {
+			state.pad++;
+		} else {
+			state.error = true;
+			break;
+		}
+	}
+	return out - dst;
+}
+
+// Flushes a final partial quad (input without '=' padding is accepted)
+inline size_t decode_finish(DecodeState &state, uint8_t *dst, size_t dst_len) {
+	size_t n = 0;
+	if (state.count == 1 || (state.count > 1 && dst_len < state.count - 1u)) {
+		state.error = true;
+	} else if (state.count == 2) {
+		dst[n++] = (state.acc >> 4) & 0xFF;
+	} else if (state.count == 3) {
+		dst[n++] = (state.acc >> 10) & 0xFF;
+		dst[n++] = (state.acc >> 2) & 0xFF;
+	}
+	state.acc = 0;
+	state.count = 0;
+	return n;
+}
+
+#if METAMODULE_BASE64_VECTOR
+
+typedef uint8_t u8x16 __attribute__((vector_size(16)));
+typedef int8_t i8x16 __attribute__((vector_size(16)));
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+typedef uint64_t u64x2 __attribute__((vector_size(16)));
+
+#if defined(__clang__)
+#define METAMODULE_BASE64_SHUFFLE(v, ...) __builtin_shufflevector(v, v, __VA_ARGS__)
+#else
+#define METAMODULE_BASE64_SHUFFLE(v, ...) __builtin_shuffle(v, u8x16{__VA_ARGS__})
+#endif
+
+// Encodes 12 bytes into 16 chars. Reads 16 bytes from src.
+inline void encode_block(const uint8_t *src, char *dst) {
+	u8x16 in;
+	std::memcpy(&in, src, 16);
+
+	// Each 32-bit lane gets bytes b1 b0 b2 b1 of one 3-byte group
+	u32x4 x = (u32x4)METAMODULE_BASE64_SHUFFLE(in, 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+	u32x4 sextets = ((x >> 10) & 0x3F) | (((x >> 4) & 0x3F) << 8) | (((x >> 22) & 0x3F) << 16) |
+					(((x >> 16) & 0x3F) << 24);
+
+	i8x16 s = (i8x16)sextets;
+	i8x16 offset = 'A' + ((s > 25) & 6) + ((s > 51) & -75) + ((s == 62) & -15) + ((s == 63) & -12);
+	u8x16 out = (u8x16)(s + offset);
+
+	std::memcpy(dst, &out, 16);
+}
+
+// Decodes 16 chars into 12 bytes. Returns false (and writes nothing) if any
+// char is not in the base64 alphabet, including whitespace and padding.
+inline bool decode_block(const char *src, uint8_t *dst) {
+	i8x16 c;
+	std::memcpy(&c, src, 16);
+
+	i8x16 upper = (c >= 'A') & (c <= 'Z');
+	i8x16 lower = (c >= 'a') & (c <= 'z');
+	i8x16 digit = (c >= '0') & (c <= '9');
+	i8x16 plus = c == '+';
+	i8x16 slash = c == '/';
+
+	u64x2 valid = (u64x2)(upper | lower | digit | plus | slash);
+	if ((valid[0] & valid[1]) != ~0ULL)
+		return false;
+
+	i8x16 s = (upper & (c - 65)) | (lower & (c - 71)) | (digit & (c + 4)) | (plus & 62) | (slash & 63);
+
+	u32x4 x = (u32x4)s;
+	u32x4 v = ((x & 0x3F) << 18) | (((x >> 8) & 0x3F) << 12) | (((x >> 16) & 0x3F) << 6) | (x >> 24);
+
+	u8x16 out = METAMODULE_BASE64_SHUFFLE((u8x16)v, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, 3, 7, 11, 15);
+	std::memcpy(dst, &out, 12);
+	return true;
+}
+
+#undef METAMODULE_BASE64_SHUFFLE
+
+#endif
+
+inline void encode(const uint8_t *src, size_t len, char *dst) {
+	size_t i = 0;
+#if METAMODULE_BASE64_VECTOR
+	for (; i + 16 <= len; i += 12, dst += 16)
+		encode_block(src + i, dst);
+#endif
+	encode_scalar(src + i, len - i, dst);
+}
+
+// Decodes as much of src as possible, writing at most dst_len bytes.
+// dst may alias src: output never overtakes input.
+inline size_t decode(DecodeState &state, const char *src, size_t src_len, uint8_t *dst, size_t dst_len) {
+	size_t i = 0;
+	size_t n = 0;
+
+#if METAMODULE_BASE64_VECTOR
+	while (src_len - i >= 16 && dst_len - n >= 12 && !state.error) {
+		if (state.count == 0 && !state.pad && decode_block(src + i, dst + n)) {
+			i += 16;
+			n += 12;
+		} else {
+			// Line break, padding, or a partial quad: use the scalar decoder up to the
+			// next quad boundary, so the vector kernel can resume after a line break
+			do {
+				n += decode_scalar(state, src + i, 1, dst + n, dst_len - n);
+				i++;
+			} while (state.count && i < src_len && !state.error);
+		}
+	}
+#endif
+
+	if (!state.error)
+		n += decode_scalar(state, src + i, src_len - i, dst + n, dst_len - n);
+
+	return n;
+}
+
+constexpr size_t encoded_size(size_t raw_size) {
+	return (raw_size + 2) / 3 * 4;
+}
+
+// Upper bound on the decoded size, before whitespace and padding are accounted for
+constexpr size_t max_decoded_size(size_t encoded_size) {
+	return (encoded_size + 3) / 4 * 3;
+}
+
+constexpr size_t decoded_size(std::string_view encoded) {
+	size_t num_chars = 0;
+	for (char c : encoded) {
+		if (decode_table.v[static_cast<uint8_t>(c)] < 64)
+			num_chars++;
+	}
+	auto rem = num_chars % 4;
+	return num_chars / 4 * 3 + (rem > 1 ? rem - 1 : 0);
+}
+
+} // namespace Base64Detail
+
 struct Base64 {
 	// Patch file yaml -> decode -> raw bytes for module
+	// Line breaks and spaces in the input are ignored.
+	// Returns an empty vector if the input is not valid base64.
 	static std::vector<uint8_t> decode(std::string_view base64_string) {
-		RymlInit::init_once();
+		std::vector<uint8_t> decoded_data(Base64Detail::max_decoded_size(base64_string.size()));
 
-		auto needed_size = c4::base64_decode({base64_string.data(), base64_string.size()}, {});
-		std::vector<uint8_t> decoded_data(needed_size);
-		c4::base64_decode({base64_string.data(), base64_string.size()}, {decoded_data.data(), decoded_data.size()});
+		auto size = decode_into(base64_string, decoded_data);
+		if (!size)
+			return {};
 
+		decoded_data.resize(*size);
 		return decoded_data;
 	}
 
+	// Decodes directly into a caller's buffer, such as a module's DSP buffer.
+	// Returns the number of bytes written, or nullopt if the input is not valid base64
+	// or the decoded data does not fit. Use decoded_size() to size the buffer.
+	static std::optional<size_t> decode_into(std::string_view base64_string, std::span<uint8_t> dest) {
+		Base64Detail::DecodeState state;
+		auto size =
+			Base64Detail::decode(state, base64_string.data(), base64_string.size(), dest.data(), dest.size());
+		size += Base64Detail::decode_finish(state, dest.data() + size, dest.size() - size);
+
+		if (state.error)
+			return std::nullopt;
+		return size;
+	}
+
+	// Decodes in place, overwriting the encoded data. No memory is allocated.
+	// Returns the decoded bytes (a prefix of the buffer), or an empty span if the input is not valid base64.
+	static std::span<uint8_t> decode_in_place(std::span<char> base64_buffer) {
+		auto *bytes = reinterpret_cast<uint8_t *>(base64_buffer.data());
+		auto size = decode_into({base64_buffer.data(), base64_buffer.size()}, {bytes, base64_buffer.size()});
+		if (!size)
+			return {};
+		return {bytes, *size};
+	}
+
+	// Exact number of bytes that decoding the (valid) input will produce
+	static constexpr size_t decoded_size(std::string_view base64_string) {
+		return Base64Detail::decoded_size(base64_string);
+	}
+
 	// Raw bytes from module -> encode -> patch file yaml
 	static std::string encode(std::span<const uint8_t> raw_data) {
-		RymlInit::init_once();
-
-		// Encode bytes into base64
-		auto needed_size = c4::base64_encode({}, {raw_data.data(), raw_data.size()});
-		std::string encoded_data(needed_size, '\0');
-		c4::base64_encode({encoded_data.data(), encoded_data.size()}, {raw_data.data(), raw_data.size()});
+		std::string encoded_data(Base64Detail::encoded_size(raw_data.size()), '\0');
+		Base64Detail::encode(raw_data.data(), raw_data.size(), encoded_data.data());
 		return encoded_data;
 	}
+
+	// Incremental encoder for states too large to hold twice in memory.
+	// Feed raw bytes in chunks of any size, then call finish() once.
+	// Output is identical to encode() on the whole data.
+	class Encoder {
+	public:
+		// Max chars written by encode() for a chunk of this size
+		static constexpr size_t max_output_size(size_t chunk_size) {
+			return Base64Detail::encoded_size(chunk_size);
+		}
+
+		// Max chars written by finish()
+		static constexpr size_t MaxFinishSize = 4;
+
+		// Returns the number of chars written, or nullopt if dest is smaller than max_output_size()
+		std::optional<size_t> encode(std::span<const uint8_t> chunk, std::span<char> dest) {
+			if (dest.size() < max_output_size(chunk.size()))
+				return std::nullopt;
+
+			size_t written = 0;
+
+			// Complete a group left over from the last chunk
+			while (num_pending > 0 && num_pending < 3 && !chunk.empty()) {
+				pending[num_pending++] = chunk.front();
+				chunk = chunk.subspan(1);
+			}
+			if (num_pending == 3) {
+				Base64Detail::encode_scalar(pending, 3, dest.data());
+				written += 4;
+				num_pending = 0;
+			}
+
+			auto whole = chunk.size() / 3 * 3;
+			Base64Detail::encode(chunk.data(), whole, dest.data() + written);
+			written += whole / 3 * 4;
+
+			for (auto b : chunk.subspan(whole))
+				pending[num_pending++] = b;
+
+			return written;
+		}
+
+		// Encodes any leftover bytes, with padding
+		size_t finish(std::span<char, MaxFinishSize> dest) {
+			Base64Detail::encode_scalar(pending, num_pending, dest.data());
+			auto written = num_pending ? 4u : 0u;
+			num_pending = 0;
+			return written;
+		}
+
+	private:
+		uint8_t pending[3]{};
+		uint8_t num_pending = 0;
+	};
+
+	// Incremental decoder: feed base64 text in chunks split anywhere (even inside
+	// a group of four chars or between a line break), then call finish() once.
+	class Decoder {
+	public:
+		// Max bytes written by decode() for a chunk of this size
+		static constexpr size_t max_output_size(size_t chunk_size) {
+			return Base64Detail::max_decoded_size(chunk_size);
+		}
+
+		// Max bytes written by finish()
+		static constexpr size_t MaxFinishSize = 2;
+
+		// Returns the number of bytes written, or nullopt if the input is not valid base64
+		// or dest is smaller than max_output_size()
+		std::optional<size_t> decode(std::string_view chunk, std::span<uint8_t> dest) {
+			if (state.error || dest.size() < max_output_size(chunk.size()))
+				return std::nullopt;
+
+			auto written = Base64Detail::decode(state, chunk.data(), chunk.size(), dest.data(), dest.size());
+			if (state.error)
+				return std::nullopt;
+			return written;
+		}
+
+		// Decodes the final partial group, if the input was not padded
+		std::optional<size_t> finish(std::span<uint8_t, MaxFinishSize> dest) {
+			auto written = Base64Detail::decode_finish(state, dest.data(), dest.size());
+			if (state.error)
+				return std::nullopt;
+			return written;
+		}
+
+	private:
+		Base64Detail::DecodeState state;
+	};
 };
 } // namespace MetaModule
@@ -0,0 +1,71 @@
+#include "../base64.hh"
+#include "bench.hh"
+
+#if __has_include("c4/base64.hpp")
+#include "c4/base64.hpp"
+#define HAVE_C4_BASE64 1
+#endif
+
+using namespace MetaModule;
+using namespace MetaModule::Bench;
+
+static std::vector<uint8_t> random_state(size_t size) {
+	std::vector<uint8_t> v(size);
+	uint32_t x = 1;
+	for (auto &b : v) {
+		x = x * 1664525 + 1013904223;
+		b = x >> 24;
+	}
+	return v;
+}
+
+BENCHMARK("base64") {
+	for (size_t size : {256, 64 * 1024, 4 * 1024 * 1024}) {
+		auto raw = random_state(size);
+		auto encoded = Base64::encode(raw);
+		auto sz = std::to_string(size);
+
+		results.push_back(run("base64/encode/" + sz, size, [&] { do_not_optimize(Base64::encode(raw)); }));
+
+		results.push_back(run("base64/encode_scalar/" + sz, size, [&] {
+			std::string out(Base64Detail::encoded_size(raw.size()), '\0');
+			Base64Detail::encode_scalar(raw.data(), raw.size(), out.data());
+			do_not_optimize(out);
+		}));
+
+		results.push_back(run("base64/decode/" + sz, size, [&] { do_not_optimize(Base64::decode(encoded)); }));
+
+		results.push_back(run("base64/decode_scalar/" + sz, size, [&] {
+			std::vector<uint8_t> out(Base64Detail::max_decoded_size(encoded.size()));
+			Base64Detail::DecodeState state;
+			do_not_optimize(Base64Detail::decode_scalar(state, encoded.data(), encoded.size(), out.data(), out.size()));
+		}));
+
+		// Same data wrapped at 76 columns, as a YAML literal block might contain it
+		std::string wrapped;
+		for (size_t i = 0; i < encoded.size(); i += 76)
+			wrapped.append(encoded, i, 76).push_back('\n');
+		results.push_back(
+			run("base64/decode_wrapped/" + sz, size, [&] { do_not_optimize(Base64::decode(wrapped)); }));
+
+		// Decoding straight into a module's existing buffer
+		std::vector<uint8_t> dsp_buffer(Base64::decoded_size(encoded));
+		results.push_back(run("base64/decode_into/" + sz, size, [&] {
+			do_not_optimize(Base64::decode_into(encoded, dsp_buffer));
+		}));
+
+#if HAVE_C4_BASE64
+		results.push_back(run("base64/c4_encode/" + sz, size, [&] {
+			std::string out(c4::base64_encode({}, {raw.data(), raw.size()}), '\0');
+			c4::base64_encode({out.data(), out.size()}, {raw.data(), raw.size()});
+			do_not_optimize(out);
+		}));
+
+		results.push_back(run("base64/c4_decode/" + sz, size, [&] {
+			std::vector<uint8_t> out(c4::base64_decode({encoded.data(), encoded.size()}, {}));
+			c4::base64_decode({encoded.data(), encoded.size()}, {out.data(), out.size()});
+			do_not_optimize(out);
+		}));
+#endif
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace MetaModule::Bench
+{
+
+struct Result {
+	std::string name;
+	size_t iterations = 0;
+	double ns_per_iter = 0;
+	size_t bytes_per_iter = 0;
+
+	double mb_per_sec() const {
+		return ns_per_iter > 0 ? (double)bytes_per_iter * 1000. / ns_per_iter : 0;
+	}
+};
+
+// Keeps the compiler from optimizing away a value the benchmark computes
+template<typename T>
+inline void do_not_optimize(T const &val) {
+	asm volatile("" : : "r,m"(val) : "memory");
+}
+
+// Runs func repeatedly for at least min_seconds and reports the average time per call.
+// bytes is the amount of data processed per call, or 0 if throughput isn't meaningful.
+template<typename F>
+Result run(std::string name, size_t bytes, F &&func, double min_seconds = 0.2) {
+	using Clock = std::chrono::steady_clock;
+
+	func(); // warm up
+
+	size_t iterations = 0;
+	size_t batch = 1;
+	auto start = Clock::now();
+	std::chrono::duration<double> elapsed{};
+
+	while (elapsed.count() < min_seconds) {
+		for (size_t i = 0; i < batch; i++)
+			func();
+		iterations += batch;
+		batch *= 2;
+		elapsed = Clock::now() - start;
+	}
+
+	return {std::move(name), iterations, elapsed.count() * 1e9 / (double)iterations, bytes};
+}
+
+struct Registry {
+	struct Entry {
+		const char *name;
+		std::function<void(std::vector<Result> &)> func;
+	};
+
+	static std::vector<Entry> &entries() {
+		static std::vector<Entry> list;
+		return list;
+	}
+
+	Registry(const char *name, std::function<void(std::vector<Result> &)> func) {
+		entries().push_back({name, std::move(func)});
+	}
+};
+
+inline void print(Result const &r) {
+	if (r.bytes_per_iter)
+		printf("%-48s %12.1f ns/iter %10.1f MB/s\n", r.name.c_str(), r.ns_per_iter, r.mb_per_sec());
+	else
+		printf("%-48s %12.1f ns/iter\n", r.name.c_str(), r.ns_per_iter);
+}
+
+inline void write_json(FILE *f, std::vector<Result> const &results) {
+	fprintf(f, "[\n");
+	for (size_t i = 0; auto const &r : results) {
+		fprintf(f,
+				"  {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_iter\": %.1f, \"bytes_per_iter\": %zu, "
+				"\"mb_per_sec\": %.1f}%s\n",
+				r.name.c_str(),
+				r.iterations,
+				r.ns_per_iter,
+				r.bytes_per_iter,
+				r.mb_per_sec(),
+				++i < results.size() ? "," : "");
+	}
+	fprintf(f, "]\n");
+}
+
+} // namespace MetaModule::Bench
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+// Registers a benchmark group. The body receives `std::vector<Result> &results`.
+#define BENCHMARK(name)                                                                                                \
+	static void BENCH_CONCAT(bench_func_, __LINE__)(std::vector<MetaModule::Bench::Result> & results);                \
+	static MetaModule::Bench::Registry BENCH_CONCAT(bench_reg_, __LINE__){name, BENCH_CONCAT(bench_func_, __LINE__)}; \
+	static void BENCH_CONCAT(bench_func_, __LINE__)(std::vector<MetaModule::Bench::Result> & results)
@@ -0,0 +1,45 @@
+#include "bench.hh"
+#include <cstring>
+
+using namespace MetaModule::Bench;
+
+// Usage: patch-serial-bench [--json FILE] [filter]
+// Runs every registered benchmark whose name contains filter.
+// With --json, results are also written to FILE ("-" for stdout) as a JSON array.
+int main(int argc, char **argv) {
+	const char *filter = "";
+	const char *json_path = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (!std::strcmp(argv[i], "--json") && i + 1 < argc)
+			json_path = argv[++i];
+		else
+			filter = argv[i];
+	}
+
+	std::vector<Result> all_results;
+
+	for (auto &entry : Registry::entries()) {
+		if (!std::strstr(entry.name, filter))
+			continue;
+
+		std::vector<Result> results;
+		entry.func(results);
+		for (auto &r : results) {
+			if (!json_path || std::strcmp(json_path, "-"))
+				print(r);
+			all_results.push_back(std::move(r));
+		}
+	}
+
+	if (json_path) {
+		FILE *f = std::strcmp(json_path, "-") ? fopen(json_path, "w") : stdout;
+		if (!f) {
+			fprintf(stderr, "Could not open %s\n", json_path);
+			return 1;
+		}
+		write_json(f, all_results);
+		if (f != stdout)
+			fclose(f);
+	}
+}
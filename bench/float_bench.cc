@@ -0,0 +1,62 @@
+#include "bench.hh"
+#include "ryml_serial.hh"
+
+using namespace MetaModule::Bench;
+
+static std::vector<float> knob_values(size_t n) {
+	std::vector<float> v(n);
+	uint32_t x = 7;
+	for (auto &f : v) {
+		x = x * 1664525 + 1013904223;
+		f = (float)(x >> 8) / (float)(1 << 24);
+	}
+	return v;
+}
+
+// Compares ryml's default float conversion with the ShortFloat/read_float path used by the serializer
+BENCHMARK("float") {
+	auto values = knob_values(4096);
+	char buf[64];
+
+	results.push_back(run("float/format/c4", 0, [&] {
+		for (auto f : values)
+			do_not_optimize(c4::to_chars(ryml::substr{buf, sizeof buf}, f));
+	}));
+
+	results.push_back(run("float/format/shortest", 0, [&] {
+		for (auto f : values)
+			do_not_optimize(to_chars(ryml::substr{buf, sizeof buf}, ShortFloat{f}));
+	}));
+
+	std::vector<std::string> texts;
+	for (auto f : values) {
+		auto len = to_chars(ryml::substr{buf, sizeof buf}, ShortFloat{f});
+		texts.emplace_back(buf, len);
+	}
+
+	results.push_back(run("float/parse/c4", 0, [&] {
+		for (auto const &t : texts) {
+			float f;
+			c4::from_chars(ryml::csubstr{t.data(), t.size()}, &f);
+			do_not_optimize(f);
+		}
+	}));
+
+	results.push_back(run("float/parse/from_chars", 0, [&] {
+		for (auto const &t : texts) {
+			float f;
+			std::from_chars(t.data(), t.data() + t.size(), f);
+			do_not_optimize(f);
+		}
+	}));
+
+	// Values the default formatter can't round-trip
+	size_t lossy = 0;
+	for (auto f : values) {
+		auto len = c4::to_chars(ryml::substr{buf, sizeof buf}, f);
+		float back;
+		c4::from_chars(ryml::csubstr{buf, len}, &back);
+		lossy += (back != f);
+	}
+	printf("float: %zu of %zu values did not round-trip with c4::to_chars\n", lossy, values.size());
+}
@@ -0,0 +1,83 @@
+#include "bench.hh"
+#include "patch/knob_set_plan.hh"
+#include "tests/patch_generator.hh"
+
+using namespace MetaModule;
+using namespace MetaModule::Bench;
+
+// Each iteration maps every knob of a set (or of a set switch) to its param
+BENCHMARK("knob_sets") {
+	auto pd = generate_patch({.num_knob_sets = MaxKnobSets, .mappings_per_set = LastButton + 1});
+
+	// Set 1 is a copy of set 0 with a quarter of the ranges changed, as when a set is
+	// made by copying another
+	pd.knob_sets[1] = pd.knob_sets[0];
+	for (size_t i = 0; i < pd.knob_sets[1].set.size(); i += 4)
+		pd.knob_sets[1].set[i].max *= 0.5f;
+
+	KnobSetPlan plan{pd};
+
+	std::vector<float> panel_vals(LastButton + 1);
+	for (size_t i = 0; i < panel_vals.size(); i++)
+		panel_vals[i] = float(i) / float(panel_vals.size());
+
+	auto sink = [](uint16_t module_id, uint16_t param_id, float val) {
+		do_not_optimize(module_id);
+		do_not_optimize(param_id);
+		do_not_optimize(val);
+	};
+
+	results.push_back(run("knob_sets/mapped_knobs", 0, [&] {
+		for (auto const &map : pd.knob_sets[1].set)
+			sink(map.module_id, map.param_id, map.get_mapped_val(panel_vals[map.panel_knob_id]));
+	}));
+
+	results.push_back(run("knob_sets/plan_apply", 0, [&] { plan.apply(1, panel_vals, sink); }));
+
+	std::vector<float> out(plan.set(1).size());
+	results.push_back(run("knob_sets/plan_map", 0, [&] {
+		plan.map(1, panel_vals, out);
+		do_not_optimize(out.data());
+	}));
+
+	results.push_back(run("knob_sets/plan_switch", 0, [&] { plan.apply_switch(0, 1, panel_vals, sink); }));
+}
+
+// Each iteration maps (or unmaps) the knobs of every set: 12 panel knobs, 32 expander
+// pots and 32 buttons, times 8 sets
+BENCHMARK("knob_kernels") {
+	constexpr size_t n = (LastButton + 1) * MaxKnobSets;
+
+	std::vector<MappedKnob> knobs(n);
+	std::vector<float> min(n), scale(n), inv_scale(n), panel_vals(n), out(n);
+
+	for (size_t i = 0; i < n; i++) {
+		knobs[i] = {.min = float(i % 3) * 0.1f, .max = 1.f - float(i % 5) * 0.1f};
+		min[i] = knobs[i].min;
+		scale[i] = knobs[i].max - knobs[i].min;
+		inv_scale[i] = KnobMapping::inverse_scale(scale[i]);
+		panel_vals[i] = float(i % 17) / 16.f;
+	}
+
+	results.push_back(run("knob_kernels/get_mapped_val", 0, [&] {
+		for (size_t i = 0; i < n; i++)
+			out[i] = knobs[i].get_mapped_val(panel_vals[i]);
+		do_not_optimize(out.data());
+	}));
+
+	results.push_back(run("knob_kernels/map_values", 0, [&] {
+		KnobMapping::map_values(min.data(), scale.data(), panel_vals.data(), out.data(), n);
+		do_not_optimize(out.data());
+	}));
+
+	results.push_back(run("knob_kernels/unmap_val", 0, [&] {
+		for (size_t i = 0; i < n; i++)
+			out[i] = knobs[i].unmap_val(panel_vals[i]);
+		do_not_optimize(out.data());
+	}));
+
+	results.push_back(run("knob_kernels/unmap_values", 0, [&] {
+		KnobMapping::unmap_values(min.data(), inv_scale.data(), panel_vals.data(), out.data(), n);
+		do_not_optimize(out.data());
+	}));
+}
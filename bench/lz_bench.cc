@@ -0,0 +1,36 @@
+#include "../lz.hh"
+#include "bench.hh"
+#include <string>
+
+using namespace MetaModule;
+using namespace MetaModule::Bench;
+
+// Block-style patch yaml, without needing the yaml writer
+static std::string patch_like_text(unsigned num_records) {
+	std::string s = "PatchData:\n  static_knobs:\n";
+	for (unsigned i = 0; i < num_records; i++) {
+		s += "    - module_id: " + std::to_string(i / 8) + "\n";
+		s += "      param_id: " + std::to_string(i % 8) + "\n";
+		s += "      value: 0." + std::to_string((i * 7919) % 1000) + "\n";
+	}
+	return s;
+}
+
+BENCHMARK("lz") {
+	for (unsigned num_records : {100, 10000}) {
+		auto text = patch_like_text(num_records);
+		std::span<const uint8_t> raw{reinterpret_cast<const uint8_t *>(text.data()), text.size()};
+		auto frame = Lz::compress(raw);
+		auto sz = std::to_string(text.size());
+
+		fprintf(stderr, "lz: %zu bytes -> %zu bytes (%.1fx)\n", text.size(), frame.size(), double(text.size()) / frame.size());
+
+		std::vector<uint8_t> out(Lz::max_compressed_size(raw.size()));
+		results.push_back(
+			run("lz/compress/" + sz, raw.size(), [&] { do_not_optimize(Lz::compress_into(raw, out)); }));
+
+		std::vector<uint8_t> decoded(raw.size());
+		results.push_back(
+			run("lz/decompress/" + sz, raw.size(), [&] { do_not_optimize(Lz::decompress_into(frame, decoded)); }));
+	}
+}
@@ -0,0 +1,119 @@
+#include "bench.hh"
+#include "patch/midi_def.hh"
+#include "patch/midi_dispatch.hh"
+#include "patch/midi_id_table.hh"
+#include "patch/midi_router.hh"
+
+using namespace MetaModule;
+using namespace MetaModule::Bench;
+
+// Each iteration classifies every possible panel jack id, with and without a channel
+BENCHMARK("midi") {
+	std::vector<uint32_t> ids;
+	for (uint32_t id = 0; id < 0x800; id++) {
+		ids.push_back(id);
+		ids.push_back(Midi::set_midi_channel(id, 1 + id % 16));
+	}
+
+	auto classify = [&](std::string name, auto func) {
+		results.push_back(run("midi/" + name, 0, [&] {
+			for (auto id : ids)
+				do_not_optimize(func(id));
+		}));
+	};
+
+	classify("strip_midi_channel", Midi::strip_midi_channel);
+	classify("midi_channel", Midi::midi_channel);
+	classify("is_midi_panel_id", Midi::is_midi_panel_id);
+	classify("is_midi_poly_cable", Midi::is_midi_poly_cable);
+	classify("polychan", Midi::polychan);
+	classify("midi_note_pitch", Midi::midi_note_pitch);
+	classify("midi_note_gate", Midi::midi_note_gate);
+	classify("midi_poly_cable_event", Midi::midi_poly_cable_event);
+	classify("midi_gate", Midi::midi_gate);
+	classify("midi_cc", Midi::midi_cc);
+	classify("midi_clk", Midi::midi_clk);
+	classify("midi_divclk", Midi::midi_divclk);
+	classify("midi_transport", Midi::midi_transport);
+
+	classify("id_table/polychan", [](uint32_t id) { return Midi::id_info(id).polychan(); });
+	classify("id_table/poly_cable_event", [](uint32_t id) { return Midi::id_info(id).poly_cable_event(); });
+	classify("id_table/note_gate", [](uint32_t id) { return Midi::id_info(id).note_gate(); });
+	classify("id_table/cc", [](uint32_t id) { return Midi::id_info(id).cc(); });
+	classify("id_table/divclk", [](uint32_t id) { return Midi::id_info(id).divclk(); });
+}
+
+// Each iteration routes a stream of CC messages to a patch's MIDI maps
+BENCHMARK("midi_dispatch") {
+	for (unsigned num_maps : {8u, 64u, 256u}) {
+		PatchData pd;
+		pd.blank_patch("midi");
+		pd.add_module("Osc");
+		for (unsigned i = 0; i < num_maps; i++)
+			pd.add_update_midi_map({.panel_knob_id = uint16_t(MidiCC0 + i % NumMidiCCs),
+									.module_id = 1,
+									.param_id = uint16_t(i),
+									.midi_chan = uint8_t(i % 3),
+									.min = 0,
+									.max = 1});
+
+		std::vector<std::pair<uint8_t, uint8_t>> msgs; // channel, CC
+		for (unsigned i = 0; i < 1024; i++)
+			msgs.push_back({uint8_t(1 + i % 4), uint8_t((i * 37) % NumMidiCCs)});
+
+		auto suffix = "/" + std::to_string(num_maps) + "maps";
+
+		results.push_back(run("midi_dispatch/linear_search" + suffix, 0, [&] {
+			for (auto [chan, cc] : msgs) {
+				for (auto const &m : pd.midi_maps.set) {
+					if (m.panel_knob_id == MidiCC0 + cc && (m.midi_chan == 0 || m.midi_chan == chan))
+						do_not_optimize(m.get_mapped_val(0.5f));
+				}
+			}
+		}));
+
+		MidiDispatchTable table{pd};
+		results.push_back(run("midi_dispatch/table" + suffix, 0, [&] {
+			for (auto [chan, cc] : msgs) {
+				table.dispatch_cc(
+					chan, cc, 64, [](auto const &t, uint16_t value) { do_not_optimize(t.get_mapped_val(value)); });
+			}
+		}));
+	}
+}
+
+// Each iteration finds the jacks fed by a stream of CC and note gate messages
+BENCHMARK("midi_router") {
+	PatchData pd;
+	pd.blank_patch("midi");
+	for (unsigned i = 0; i < 64; i++) {
+		uint32_t id = (i % 2) ? MidiCC0 + i : MidiMonoGateJack + i % MaxMidiPolyphony;
+		pd.add_mapped_injack(uint16_t(Midi::set_midi_channel(id, i % 3)), {uint16_t(i), 0});
+	}
+
+	std::vector<std::pair<uint8_t, uint16_t>> msgs; // channel, panel jack id without channel
+	for (unsigned i = 0; i < 1024; i++) {
+		uint32_t id = (i % 2) ? MidiCC0 + (i * 37) % NumMidiCCs : MidiMonoGateJack + i % MaxMidiPolyphony;
+		msgs.push_back({uint8_t(1 + i % 4), uint16_t(id)});
+	}
+
+	results.push_back(run("midi_router/decode_mapped_ins", 0, [&] {
+		for (auto [chan, id] : msgs) {
+			for (auto const &map : pd.mapped_ins) {
+				if (Midi::strip_midi_channel(map.panel_jack_id) != id)
+					continue;
+				auto map_chan = Midi::midi_channel(map.panel_jack_id);
+				if (map_chan == 0 || map_chan == chan) {
+					for (auto const &jack : map.ins)
+						do_not_optimize(jack);
+				}
+			}
+		}
+	}));
+
+	MidiJackRouter router{pd};
+	results.push_back(run("midi_router/router", 0, [&] {
+		for (auto [chan, id] : msgs)
+			router.route(id, chan).for_each([](Jack const &jack) { do_not_optimize(jack); });
+	}));
+}
@@ -0,0 +1,69 @@
+#include "bench.hh"
+#include "patch_to_yaml.hh"
+#include "tests/patch_generator.hh"
+#include "yaml_to_patch.hh"
+
+using namespace MetaModule;
+using namespace MetaModule::Bench;
+
+static constexpr unsigned patch_sizes[] = {10, 100, 1000, 10000};
+
+BENCHMARK("yaml") {
+	for (auto num_modules : patch_sizes) {
+		auto pd = generate_patch({.num_modules = num_modules});
+		auto yaml = patch_to_yaml_string(pd);
+		auto sz = std::to_string(num_modules);
+
+		results.push_back(
+			run("yaml/patch_to_yaml_string/" + sz, yaml.size(), [&] { do_not_optimize(patch_to_yaml_string(pd)); }));
+
+		std::vector<char> out(yaml.size() * 2);
+		results.push_back(run("yaml/patch_to_yaml_buffer/" + sz, yaml.size(), [&] {
+			std::span<char> buffer{out};
+			do_not_optimize(patch_to_yaml_buffer(pd, buffer));
+		}));
+
+		// The parser works in place, so each iteration parses a fresh copy of the file.
+		// The copy is timed separately so it can be subtracted.
+		std::vector<char> work(yaml.size());
+		results.push_back(run("yaml/copy_source/" + sz, yaml.size(), [&] {
+			std::copy(yaml.begin(), yaml.end(), work.begin());
+			do_not_optimize(work);
+		}));
+
+		results.push_back(run("yaml/yaml_raw_to_patch/" + sz, yaml.size(), [&] {
+			std::copy(yaml.begin(), yaml.end(), work.begin());
+			PatchData loaded;
+			do_not_optimize(yaml_raw_to_patch(work, loaded));
+		}));
+
+		auto compact = patch_to_yaml_string(pd, {.compact = true});
+		results.push_back(run("yaml/patch_to_yaml_string_compact/" + sz, compact.size(), [&] {
+			do_not_optimize(patch_to_yaml_string(pd, {.compact = true}));
+		}));
+
+		results.push_back(run("yaml/yaml_raw_to_patch_compact/" + sz, compact.size(), [&] {
+			std::copy(compact.begin(), compact.end(), work.begin());
+			PatchData loaded;
+			do_not_optimize(yaml_raw_to_patch({work.data(), compact.size()}, loaded));
+		}));
+	}
+}
+
+BENCHMARK("json") {
+	for (auto num_modules : patch_sizes) {
+		auto pd = generate_patch({.num_modules = num_modules});
+		auto json = patch_to_json_string(pd);
+		auto sz = std::to_string(num_modules);
+
+		results.push_back(
+			run("json/patch_to_json_string/" + sz, json.size(), [&] { do_not_optimize(patch_to_json_string(pd)); }));
+
+		std::vector<char> work(json.size());
+		results.push_back(run("json/json_to_patch/" + sz, json.size(), [&] {
+			std::copy(json.begin(), json.end(), work.begin());
+			PatchData loaded;
+			do_not_optimize(json_to_patch(work, loaded));
+		}));
+	}
+}
@@ -0,0 +1,54 @@
+#include "bench.hh"
+#include "tests/patch_generator.hh"
+
+using namespace MetaModule;
+using namespace MetaModule::Bench;
+
+static constexpr unsigned patch_sizes[] = {10, 100, 1000, 10000};
+
+// Lookups are timed over a full sweep of module ids, so the per-iteration time is
+// for num_modules lookups.
+BENCHMARK("patch_data") {
+	for (auto num_modules : patch_sizes) {
+		auto pd = generate_patch({.num_modules = num_modules});
+		auto sz = std::to_string(num_modules);
+
+		results.push_back(run("patch_data/find_mapped_knob/" + sz, 0, [&] {
+			for (uint16_t i = 0; i < num_modules; i++)
+				do_not_optimize(pd.find_mapped_knob(0, i, 0));
+		}));
+
+		results.push_back(run("patch_data/find_static_knob/" + sz, 0, [&] {
+			for (uint16_t i = 0; i < num_modules; i++)
+				do_not_optimize(pd.find_static_knob(i, 7));
+		}));
+
+		results.push_back(run("patch_data/get_static_knob_value/" + sz, 0, [&] {
+			for (uint16_t i = 0; i < num_modules; i++)
+				do_not_optimize(pd.get_static_knob_value(i, 7));
+		}));
+
+		results.push_back(run("patch_data/find_internal_cable_with_injack/" + sz, 0, [&] {
+			for (uint16_t i = 0; i < num_modules; i++)
+				do_not_optimize(pd.find_internal_cable_with_injack({i, 1}));
+		}));
+
+		// Mutators work on a copy each iteration; the copy alone is the baseline
+		results.push_back(run("patch_data/copy/" + sz, 0, [&] {
+			PatchData copy = pd;
+			do_not_optimize(copy);
+		}));
+
+		results.push_back(run("patch_data/remove_module/" + sz, 0, [&] {
+			PatchData copy = pd;
+			copy.remove_module(num_modules / 2);
+			do_not_optimize(copy);
+		}));
+
+		results.push_back(run("patch_data/disconnect_injack/" + sz, 0, [&] {
+			PatchData copy = pd;
+			copy.disconnect_injack({uint16_t(num_modules / 2), 0});
+			do_not_optimize(copy);
+		}));
+	}
+}
@@ -0,0 +1,358 @@
+#include "json_to_yml_stream.hh"
+#include <algorithm>
+#include <cstring>
+
+namespace MetaModule
+{
+
+namespace
+{
+
+bool is_whitespace(char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\0';
+}
+
+bool is_literal_char(char c) {
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+bool is_number(std::string_view s) {
+	if (s.starts_with('-'))
+		s.remove_prefix(1);
+	if (s.empty() || s[0] < '0' || s[0] > '9')
+		return false;
+	return s.find_first_not_of("0123456789.eE+-") == std::string_view::npos;
+}
+
+// Strings that read back as the same string when written without quotes
+bool is_plain_safe(std::string_view s) {
+	if (s.empty())
+		return false;
+
+	auto first = s[0];
+	if (!((first >= 'a' && first <= 'z') || (first >= 'A' && first <= 'Z') || first == '_'))
+		return false;
+
+	for (auto c : s) {
+		bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' ||
+				  c == '-' || c == '.' || c == '/';
+		if (!ok)
+			return false;
+	}
+
+	// Words YAML reads as booleans or null
+	constexpr std::string_view reserved[] = {"true", "false", "null", "yes", "no", "on", "off", "y", "n"};
+	for (auto word : reserved) {
+		if (std::equal(s.begin(), s.end(), word.begin(), word.end(), [](char a, char b) {
+				return (a | 0x20) == b;
+			}))
+			return false;
+	}
+	return true;
+}
+
+} // namespace
+
+JsonToYmlStream::JsonToYmlStream(Sink sink)
+	: sink{std::move(sink)} {
+}
+
+bool JsonToYmlStream::fail() {
+	expect = Expect::Error;
+	return false;
+}
+
+bool JsonToYmlStream::feed(std::string_view json) {
+	for (auto c : json) {
+		if (!process(c))
+			return fail();
+	}
+	if (sink_failed)
+		return fail();
+	return true;
+}
+
+bool JsonToYmlStream::finish() {
+	if (token == Token::Literal && !end_literal())
+		return fail();
+
+	if (expect != Expect::Done || token != Token::None)
+		return fail();
+
+	if (!flush())
+		return fail();
+	return true;
+}
+
+bool JsonToYmlStream::process(char c) {
+	if (sink_failed || expect == Expect::Error)
+		return false;
+
+	if (token == Token::String || token == Token::Key) {
+		string_char(c);
+		return true;
+	}
+
+	if (token == Token::Literal) {
+		if (is_literal_char(c)) {
+			if (token_len == TokenSize)
+				return false;
+			token_buf[token_len++] = c;
+			return true;
+		}
+		if (!end_literal())
+			return false;
+		// c is handled below
+	}
+
+	if (is_whitespace(c))
+		return true;
+
+	switch (expect) {
+		case Expect::Value:
+			return start_value(c);
+
+		case Expect::FirstItem:
+			if (c == ']')
+				return end_container(false);
+			return start_value(c);
+
+		case Expect::FirstKey:
+			if (c == '}')
+				return end_container(true);
+			[[fallthrough]];
+
+		case Expect::Key:
+			if (c != '"')
+				return false;
+			start_child(stack[depth - 1]);
+			start_token(Token::Key);
+			return true;
+
+		case Expect::Colon:
+			if (c != ':')
+				return false;
+			expect = Expect::Value;
+			return true;
+
+		case Expect::CommaOrEnd: {
+			auto const &top = stack[depth - 1];
+			if (c == ',') {
+				expect = top.is_map ? Expect::Key : Expect::Value;
+				return true;
+			}
+			if (c == (top.is_map ? '}' : ']'))
+				return end_container(top.is_map);
+			return false;
+		}
+
+		case Expect::Done:
+		case Expect::Error:
+			return false;
+	}
+	return false;
+}
+
+// Writes what goes before a child: a newline if it's the first child of a key's value,
+// and the indent unless it's the first child on a `- ` line
+void JsonToYmlStream::start_child(Frame &f) {
+	if (f.count == 0 && f.context == Context::AfterKey)
+		write("\n");
+	if (f.count > 0 || f.context != Context::AfterDash)
+		write_indent(f.indent);
+	f.count++;
+}
+
+bool JsonToYmlStream::start_value(char c) {
+	bool in_map = depth > 0 && stack[depth - 1].is_map;
+	bool in_array = depth > 0 && !in_map;
+
+	if (in_array) {
+		start_child(stack[depth - 1]);
+		write("- ");
+	}
+
+	if (c == '{' || c == '[') {
+		if (depth == MaxDepth)
+			return false;
+
+		stack[depth] = {
+			.is_map = c == '{',
+			.context = in_map ? Context::AfterKey : in_array ? Context::AfterDash : Context::Root,
+			.indent = uint16_t(depth ? stack[depth - 1].indent + 2 : 0),
+			.count = 0,
+		};
+		depth++;
+		expect = c == '{' ? Expect::FirstKey : Expect::FirstItem;
+		return true;
+	}
+
+	if (in_map)
+		write(" ");
+
+	if (c == '"') {
+		start_token(Token::String);
+		return true;
+	}
+
+	if (is_literal_char(c)) {
+		start_token(Token::Literal);
+		token_buf[token_len++] = c;
+		return true;
+	}
+
+	return false;
+}
+
+bool JsonToYmlStream::end_container(bool is_map) {
+	auto const &f = stack[depth - 1];
+
+	if (f.count == 0) {
+		auto empty = is_map ? std::string_view{"{}\n"} : std::string_view{"[]\n"};
+		if (f.context == Context::AfterKey)
+			write(" ");
+		write(empty);
+	}
+
+	depth--;
+	value_done();
+	return true;
+}
+
+void JsonToYmlStream::start_token(Token t) {
+	token = t;
+	token_len = 0;
+	streaming = false;
+	plain = true;
+	escape = false;
+}
+
+void JsonToYmlStream::value_done() {
+	expect = depth == 0 ? Expect::Done : Expect::CommaOrEnd;
+}
+
+void JsonToYmlStream::string_char(char c) {
+	if (escape) {
+		escape = false;
+		// YAML has no \/ escape in every parser, and doesn't need one
+		if (c == '/') {
+			string_bytes("/");
+		} else {
+			char escaped[2] = {'\\', c};
+			string_bytes({escaped, 2});
+		}
+		return;
+	}
+
+	if (c == '\\') {
+		escape = true;
+		plain = false;
+		return;
+	}
+
+	if (c == '"') {
+		end_string();
+		return;
+	}
+
+	string_bytes({&c, 1});
+}
+
+void JsonToYmlStream::string_bytes(std::string_view s) {
+	if (!streaming && token_len + s.size() > TokenSize) {
+		streaming = true;
+		write("\"");
+		write({token_buf, token_len});
+	}
+
+	if (streaming) {
+		write(s);
+	} else {
+		std::memcpy(token_buf + token_len, s.data(), s.size());
+		token_len += s.size();
+	}
+}
+
+void JsonToYmlStream::end_string() {
+	std::string_view s{token_buf, token_len};
+
+	if (streaming) {
+		write("\"");
+	} else if (plain && is_plain_safe(s)) {
+		write(s);
+	} else {
+		write("\"");
+		write(s);
+		write("\"");
+	}
+
+	if (token == Token::Key) {
+		write(":");
+		expect = Expect::Colon;
+	} else {
+		write("\n");
+		value_done();
+	}
+	token = Token::None;
+}
+
+bool JsonToYmlStream::end_literal() {
+	token = Token::None;
+
+	std::string_view s{token_buf, token_len};
+	if (s != "true" && s != "false" && s != "null" && !is_number(s))
+		return false;
+
+	write(s);
+	write("\n");
+	value_done();
+	return true;
+}
+
+void JsonToYmlStream::write(std::string_view s) {
+	while (!s.empty()) {
+		if (output_len == OutputSize && !flush())
+			return;
+
+		auto n = std::min(s.size(), OutputSize - output_len);
+		std::memcpy(output + output_len, s.data(), n);
+		output_len += n;
+		s.remove_prefix(n);
+	}
+}
+
+void JsonToYmlStream::write_indent(unsigned n) {
+	constexpr std::string_view spaces = "                ";
+	for (; n > spaces.size(); n -= spaces.size())
+		write(spaces);
+	write(spaces.substr(0, n));
+}
+
+bool JsonToYmlStream::flush() {
+	if (sink_failed)
+		return false;
+
+	if (output_len && !sink({output, output_len}))
+		sink_failed = true;
+
+	output_len = 0;
+	return !sink_failed;
+}
+
+bool json_to_yml_stream(std::string_view json, JsonToYmlStream::Sink sink) {
+	JsonToYmlStream converter{std::move(sink)};
+	return converter.feed(json) && converter.finish();
+}
+
+bool json_to_yml_stream(std::function<size_t(std::span<char>)> read, JsonToYmlStream::Sink sink) {
+	JsonToYmlStream converter{std::move(sink)};
+
+	char buf[JsonToYmlStream::OutputSize];
+	while (auto n = read(buf)) {
+		if (!converter.feed({buf, std::min(n, sizeof buf)}))
+			return false;
+	}
+	return converter.finish();
+}
+
+} // namespace MetaModule
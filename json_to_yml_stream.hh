@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string_view>
+
+namespace MetaModule
+{
+
+// Converts JSON to block-style YAML as it's read, without building a tree.
+//
+// The working set is fixed: a stack of MaxDepth open containers, a token buffer and an
+// output buffer. Nothing is allocated while converting, however large the input, and
+// the JSON can arrive in pieces of any size.
+//
+// Keys and short strings that are safe as plain scalars are written plain. Longer
+// strings are copied through as double-quoted scalars, which accept JSON's escapes.
+class JsonToYmlStream {
+public:
+	// Called with each piece of YAML, in order. Returning false stops the conversion.
+	using Sink = std::function<bool(std::string_view)>;
+
+	static constexpr size_t MaxDepth = 64;
+	static constexpr size_t TokenSize = 64;
+	static constexpr size_t OutputSize = 512;
+
+	explicit JsonToYmlStream(Sink sink);
+
+	// Returns false once the input is invalid or the sink fails
+	bool feed(std::string_view json);
+
+	// Flushes the output. Returns false if the input was invalid or incomplete.
+	bool finish();
+
+	bool failed() const {
+		return expect == Expect::Error;
+	}
+
+private:
+	enum class Expect : uint8_t { Value, FirstItem, FirstKey, Key, Colon, CommaOrEnd, Done, Error };
+	enum class Context : uint8_t { Root, AfterKey, AfterDash };
+	enum class Token : uint8_t { None, String, Key, Literal };
+
+	struct Frame {
+		bool is_map;
+		Context context;
+		uint16_t indent; // of the children
+		uint32_t count;	 // children so far
+	};
+
+	bool fail();
+	bool process(char c);
+
+	bool start_value(char c);
+	void start_child(Frame &f);
+	bool end_container(bool is_map);
+	void start_token(Token t);
+	void value_done();
+
+	void string_char(char c);
+	void string_bytes(std::string_view s);
+	void end_string();
+	bool end_literal();
+
+	void write(std::string_view s);
+	void write_indent(unsigned n);
+	bool flush();
+
+	Sink sink;
+
+	Expect expect = Expect::Value;
+	Frame stack[MaxDepth];
+	size_t depth = 0;
+
+	Token token = Token::None;
+	bool escape = false;
+	bool streaming = false; // the token outgrew the buffer and is being copied through
+	bool plain = true;		// no escapes seen in the token
+	size_t token_len = 0;
+	char token_buf[TokenSize];
+
+	size_t output_len = 0;
+	char output[OutputSize];
+	bool sink_failed = false;
+};
+
+// Converts a whole buffer
+bool json_to_yml_stream(std::string_view json, JsonToYmlStream::Sink sink);
+
+// Converts what read() returns until it returns 0. read() fills as much of the
+// buffer it's given as it likes, and returns the number of bytes.
+bool json_to_yml_stream(std::function<size_t(std::span<char>)> read, JsonToYmlStream::Sink sink);
+
+} // namespace MetaModule
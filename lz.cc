@@ -0,0 +1,347 @@
+#include "lz.hh"
+#include "base64.hh"
+#include <algorithm>
+#include <cstring>
+
+namespace MetaModule
+{
+
+namespace
+{
+
+constexpr uint8_t Magic[4] = {'M', 'M', 'L', 'Z'};
+
+enum Flags : uint8_t {
+	Stored = 0x01,	   // data follows the header uncompressed
+	Dictionary = 0x02, // matches may refer into a dictionary
+};
+
+constexpr size_t MinMatch = 4;
+constexpr size_t MaxOffset = 65535;
+constexpr size_t LastLiterals = 5; // the last bytes are always literals
+constexpr size_t MatchLimit = 12;  // no match starts closer than this to the end
+constexpr unsigned HashLog = 12;
+
+uint32_t read32(const uint8_t *p) {
+	uint32_t v;
+	std::memcpy(&v, p, 4);
+	return v;
+}
+
+void write_le32(uint8_t *p, uint32_t v) {
+	for (unsigned i = 0; i < 4; i++)
+		p[i] = uint8_t(v >> (8 * i));
+}
+
+uint32_t read_le32(const uint8_t *p) {
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+uint32_t hash4(const uint8_t *p) {
+	return (read32(p) * 2654435761u) >> (32 - HashLog);
+}
+
+// Writes sequences into a bounded output buffer. Fails once it runs out of room.
+struct SequenceWriter {
+	uint8_t *op;
+	uint8_t *oend;
+	bool overflow = false;
+
+	bool room(size_t n) {
+		if (size_t(oend - op) < n)
+			overflow = true;
+		return !overflow;
+	}
+
+	void length(size_t len) {
+		for (; len >= 255; len -= 255) {
+			if (room(1))
+				*op++ = 255;
+		}
+		if (room(1))
+			*op++ = uint8_t(len);
+	}
+
+	void sequence(const uint8_t *literals, size_t num_literals, size_t offset, size_t match_len) {
+		if (!room(1))
+			return;
+
+		auto match_code = match_len ? match_len - MinMatch : 0;
+		*op++ = uint8_t((std::min<size_t>(num_literals, 15) << 4) | std::min<size_t>(match_code, 15));
+
+		if (num_literals >= 15)
+			length(num_literals - 15);
+
+		if (!room(num_literals))
+			return;
+		std::memcpy(op, literals, num_literals);
+		op += num_literals;
+
+		if (!match_len)
+			return;
+
+		if (room(2)) {
+			*op++ = uint8_t(offset);
+			*op++ = uint8_t(offset >> 8);
+		}
+
+		if (match_code >= 15)
+			length(match_code - 15);
+	}
+};
+
+// Compresses in[start, n), where in[0, start) is dictionary content matches may refer to.
+// Returns the compressed size, or 0 if it does not fit in dst.
+size_t compress_block(const uint8_t *in, size_t start, size_t n, uint8_t *dst, size_t dst_size) {
+	std::vector<uint32_t> table(1u << HashLog, 0);
+	SequenceWriter out{dst, dst + dst_size};
+
+	for (size_t p = start > MaxOffset ? start - MaxOffset : 0; p + MinMatch <= start; p++)
+		table[hash4(in + p)] = uint32_t(p);
+
+	size_t anchor = start;
+	size_t ip = start;
+	size_t limit = n > MatchLimit ? n - MatchLimit : 0;
+
+	while (ip < limit) {
+		auto h = hash4(in + ip);
+		size_t candidate = table[h];
+		table[h] = uint32_t(ip);
+
+		if (candidate >= ip || ip - candidate > MaxOffset || read32(in + candidate) != read32(in + ip)) {
+			// Step faster through data that isn't matching
+			ip += 1 + ((ip - anchor) >> 6);
+			continue;
+		}
+
+		while (ip > anchor && candidate > 0 && in[ip - 1] == in[candidate - 1]) {
+			ip--;
+			candidate--;
+		}
+
+		size_t len = MinMatch;
+		while (ip + len < n - LastLiterals && in[ip + len] == in[candidate + len])
+			len++;
+
+		out.sequence(in + anchor, ip - anchor, ip - candidate, len);
+		if (out.overflow)
+			return 0;
+
+		ip += len;
+		anchor = ip;
+
+		if (ip - 2 + MinMatch <= n)
+			table[hash4(in + ip - 2)] = uint32_t(ip - 2);
+	}
+
+	out.sequence(in + anchor, n - anchor, 0, 0);
+	return out.overflow ? 0 : size_t(out.op - dst);
+}
+
+// Copies a match of len bytes, offset bytes back from op. The source may overlap the
+// destination, which repeats the last offset bytes.
+inline void copy_match(uint8_t *op, const uint8_t *match, size_t len, uint8_t *oend) {
+	if (op - match >= 8 && size_t(oend - op) >= len + 8) {
+		// May write up to 7 bytes past the match, which are overwritten later
+		for (size_t i = 0; i < len; i += 8)
+			std::memcpy(op + i, match + i, 8);
+	} else {
+		for (size_t i = 0; i < len; i++)
+			op[i] = match[i];
+	}
+}
+
+bool decompress_block(
+	const uint8_t *ip, const uint8_t *iend, uint8_t *dst, uint8_t *oend, std::span<const uint8_t> dict) {
+	uint8_t *op = dst;
+
+	auto read_length = [&](size_t &len) {
+		uint8_t b;
+		do {
+			if (ip == iend)
+				return false;
+			b = *ip++;
+			len += b;
+		} while (b == 255);
+		return true;
+	};
+
+	while (ip < iend) {
+		uint8_t token = *ip++;
+
+		size_t num_literals = token >> 4;
+		if (num_literals == 15 && !read_length(num_literals))
+			return false;
+
+		if (size_t(iend - ip) < num_literals || size_t(oend - op) < num_literals)
+			return false;
+		std::memcpy(op, ip, num_literals);
+		ip += num_literals;
+		op += num_literals;
+
+		// The last sequence has no match
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+
+		size_t len = token & 0x0F;
+		if (len == 15 && !read_length(len))
+			return false;
+		len += MinMatch;
+
+		if (offset == 0 || size_t(oend - op) < len)
+			return false;
+
+		size_t produced = op - dst;
+		if (offset > produced) {
+			// Starts in the dictionary, and may run on into the output
+			size_t back = offset - produced;
+			if (back > dict.size())
+				return false;
+			size_t from_dict = std::min(back, len);
+			std::memcpy(op, dict.data() + dict.size() - back, from_dict);
+			op += from_dict;
+			len -= from_dict;
+			copy_match(op, dst, len, oend);
+		} else {
+			copy_match(op, op - offset, len, oend);
+		}
+		op += len;
+	}
+
+	return op == oend;
+}
+
+} // namespace
+
+bool Lz::is_frame(std::span<const uint8_t> data) {
+	return data.size() >= HeaderSize && std::equal(std::begin(Magic), std::end(Magic), data.begin());
+}
+
+uint32_t Lz::dictionary_id(std::span<const uint8_t> dict) {
+	// FNV-1a; 0 is reserved for "no dictionary"
+	uint32_t h = 2166136261u;
+	for (auto b : dict) {
+		h ^= b;
+		h *= 16777619u;
+	}
+	return h ? h : 1;
+}
+
+size_t Lz::compress_into(std::span<const uint8_t> src, std::span<uint8_t> dst, std::span<const uint8_t> dict) {
+	if (dst.size() < HeaderSize || src.size() > UINT32_MAX)
+		return 0;
+
+	// Only the last window of the dictionary is reachable
+	if (dict.size() > MaxOffset)
+		dict = dict.last(MaxOffset);
+
+	uint8_t flags = dict.empty() ? 0 : Dictionary;
+	auto payload = dst.subspan(HeaderSize);
+
+	size_t compressed = 0;
+	if (dict.empty()) {
+		compressed = compress_block(src.data(), 0, src.size(), payload.data(), payload.size());
+	} else {
+		std::vector<uint8_t> window(dict.size() + src.size());
+		std::copy(dict.begin(), dict.end(), window.begin());
+		std::copy(src.begin(), src.end(), window.begin() + dict.size());
+		compressed = compress_block(window.data(), dict.size(), window.size(), payload.data(), payload.size());
+	}
+
+	if (compressed == 0 || compressed >= src.size()) {
+		if (payload.size() < src.size())
+			return 0;
+		std::copy(src.begin(), src.end(), payload.begin());
+		compressed = src.size();
+		flags = Stored;
+	}
+
+	std::copy(std::begin(Magic), std::end(Magic), dst.begin());
+	dst[4] = flags;
+	write_le32(&dst[5], uint32_t(src.size()));
+	write_le32(&dst[9], (flags & Dictionary) ? dictionary_id(dict) : 0);
+
+	return HeaderSize + compressed;
+}
+
+std::vector<uint8_t> Lz::compress(std::span<const uint8_t> src, std::span<const uint8_t> dict) {
+	std::vector<uint8_t> frame(max_compressed_size(src.size()));
+	frame.resize(compress_into(src, frame, dict));
+	return frame;
+}
+
+std::optional<size_t> Lz::decompressed_size(std::span<const uint8_t> frame) {
+	if (!is_frame(frame))
+		return std::nullopt;
+
+	size_t raw_size = read_le32(&frame[5]);
+	size_t payload_size = frame.size() - HeaderSize;
+
+	// Checked before anyone allocates raw_size bytes on the header's word
+	if (frame[4] & Stored) {
+		if (raw_size != payload_size)
+			return std::nullopt;
+	} else if (raw_size > payload_size * MaxExpansion) {
+		return std::nullopt;
+	}
+	return raw_size;
+}
+
+std::optional<size_t>
+Lz::decompress_into(std::span<const uint8_t> frame, std::span<uint8_t> dst, std::span<const uint8_t> dict) {
+	auto raw_size = decompressed_size(frame);
+	if (!raw_size || dst.size() < *raw_size)
+		return std::nullopt;
+
+	uint8_t flags = frame[4];
+	if (flags & ~(Stored | Dictionary))
+		return std::nullopt;
+
+	auto payload = frame.subspan(HeaderSize);
+
+	if (flags & Stored) {
+		std::copy(payload.begin(), payload.end(), dst.begin());
+		return *raw_size;
+	}
+
+	if (flags & Dictionary) {
+		if (dict.size() > MaxOffset)
+			dict = dict.last(MaxOffset);
+		if (dictionary_id(dict) != read_le32(&frame[9]))
+			return std::nullopt;
+	} else {
+		dict = {};
+	}
+
+	if (!decompress_block(payload.data(), payload.data() + payload.size(), dst.data(), dst.data() + *raw_size, dict))
+		return std::nullopt;
+
+	return *raw_size;
+}
+
+std::optional<std::vector<uint8_t>> Lz::decompress(std::span<const uint8_t> frame, std::span<const uint8_t> dict) {
+	auto raw_size = decompressed_size(frame);
+	if (!raw_size)
+		return std::nullopt;
+
+	std::vector<uint8_t> raw(*raw_size);
+	if (!decompress_into(frame, raw, dict))
+		return std::nullopt;
+	return raw;
+}
+
+std::string Lz::compress_to_base64(std::span<const uint8_t> raw, std::span<const uint8_t> dict) {
+	return Base64::encode(compress(raw, dict));
+}
+
+std::optional<std::vector<uint8_t>> Lz::decompress_base64(std::string_view encoded, std::span<const uint8_t> dict) {
+	auto frame = Base64::decode(encoded);
+	return decompress(frame, dict);
+}
+
+} // namespace MetaModule
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace MetaModule
+{
+
+// Small LZ77 codec (LZ4-style sequences) for patch files and module states.
+//
+// A frame is a 13 byte header followed by the compressed data:
+//   "MMLZ", flags, raw size (u32 LE), dictionary id (u32 LE)
+// Data that does not compress is stored as-is, so a frame is never much larger than
+// its input.
+//
+// A dictionary is a sample of typical content (e.g. a patch file from the same bank),
+// which matches can refer back into. The same dictionary must be passed to
+// decompress(); its id is checked.
+//
+// Decompression is bounds-checked on every copy, so corrupt or hostile frames fail
+// instead of reading or writing out of bounds.
+struct Lz {
+	static constexpr size_t HeaderSize = 13;
+
+	// Largest frame compress_into() can produce for raw_size bytes of input
+	static constexpr size_t max_compressed_size(size_t raw_size) {
+		return HeaderSize + raw_size;
+	}
+
+	static bool is_frame(std::span<const uint8_t> data);
+
+	static uint32_t dictionary_id(std::span<const uint8_t> dict);
+
+	// Returns the frame size, or 0 if dst is too small
+	static size_t
+	compress_into(std::span<const uint8_t> src, std::span<uint8_t> dst, std::span<const uint8_t> dict = {});
+
+	static std::vector<uint8_t> compress(std::span<const uint8_t> src, std::span<const uint8_t> dict = {});
+
+	// Each byte of compressed data decodes to at most this many bytes
+	static constexpr size_t MaxExpansion = 255;
+
+	// Size of the data in a frame, or nullopt if it's not a valid frame header. A size
+	// the frame's payload couldn't produce is rejected, so the result is safe to allocate.
+	static std::optional<size_t> decompressed_size(std::span<const uint8_t> frame);
+
+	// dst must be at least decompressed_size(frame) bytes.
+	// Returns the number of bytes written, or nullopt if the frame is invalid, dst is too
+	// small, or the dictionary does not match.
+	static std::optional<size_t>
+	decompress_into(std::span<const uint8_t> frame, std::span<uint8_t> dst, std::span<const uint8_t> dict = {});
+
+	static std::optional<std::vector<uint8_t>> decompress(std::span<const uint8_t> frame,
+														  std::span<const uint8_t> dict = {});
+
+	// Module state helpers: a compressed frame, base64 encoded for a yaml scalar
+	static std::string compress_to_base64(std::span<const uint8_t> raw, std::span<const uint8_t> dict = {});
+	static std::optional<std::vector<uint8_t>> decompress_base64(std::string_view encoded,
+																 std::span<const uint8_t> dict = {});
+};
+
+} // namespace MetaModule
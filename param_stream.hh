@@ -0,0 +1,335 @@
+#pragma once
+#include "patch/patch.hh"
+#include "patch/patch_data.hh"
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace MetaModule
+{
+
+// Compact binary messages for streaming static knob values and mapping changes
+// to the device, e.g. while the user sweeps a knob in the editor.
+//
+// Message layout:
+//   'P' 'S' version
+//   record...
+//   End tag
+//
+// Every record begins with a tag byte, followed by the module_id and param_id as
+// zigzag varint deltas from the previous record. Sweeping one or two knobs costs
+// about 7 bytes per update.
+//   StaticKnob: value (f32 LE)
+//   Mapping:    set (varint, 0 = MIDI, else set_id + 1), panel_knob_id (varint),
+//               curve_type, midi_chan, min (f32 LE), max (f32 LE), alias length, alias chars
+//   Unmapping:  set (varint)
+//
+// Encoder and decoder never allocate: they work on caller-provided buffers.
+
+struct ParamStreamRecord {
+	enum class Type : uint8_t { End = 0, StaticKnob = 1, Mapping = 2, Unmapping = 3 };
+
+	Type type = Type::End;
+	uint32_t set_id = 0;	   // Mapping and Unmapping only
+	StaticParam knob{};		   // StaticKnob: module, param, value. Others: module, param
+	MappedKnob map{};		   // Mapping only
+};
+
+namespace ParamStream
+{
+static constexpr uint8_t Magic0 = 'P';
+static constexpr uint8_t Magic1 = 'S';
+static constexpr uint8_t Version = 1;
+static constexpr size_t HeaderSize = 3;
+
+// Worst case size of one record, useful for sizing buffers
+static constexpr size_t MaxStaticKnobRecordSize = 1 + 3 + 3 + 4;
+static constexpr size_t MaxMappingRecordSize = 1 + 3 + 3 + 5 + 3 + 2 + 8 + 1 + sizeof(AliasNameString);
+
+constexpr uint32_t zigzag(int32_t x) {
+	return (static_cast<uint32_t>(x) << 1) ^ static_cast<uint32_t>(x >> 31);
+}
+
+constexpr int32_t unzigzag(uint32_t x) {
+	return static_cast<int32_t>(x >> 1) ^ -static_cast<int32_t>(x & 1);
+}
+
+static_assert(unzigzag(zigzag(-1)) == -1);
+static_assert(unzigzag(zigzag(65535)) == 65535);
+static_assert(zigzag(-1) == 1 && zigzag(1) == 2);
+
+constexpr uint32_t encode_set_id(uint32_t set_id) {
+	return set_id == PatchData::MIDIKnobSet ? 0 : set_id + 1;
+}
+
+constexpr uint32_t decode_set_id(uint32_t encoded) {
+	return encoded == 0 ? PatchData::MIDIKnobSet : encoded - 1;
+}
+
+} // namespace ParamStream
+
+class ParamStreamWriter {
+public:
+	explicit ParamStreamWriter(std::span<uint8_t> buffer)
+		: buf{buffer} {
+		put(ParamStream::Magic0);
+		put(ParamStream::Magic1);
+		put(ParamStream::Version);
+	}
+
+	bool add_static_knob(StaticParam const &knob) {
+		auto start = pos;
+		put(static_cast<uint8_t>(ParamStreamRecord::Type::StaticKnob));
+		put_ids(knob.module_id, knob.param_id);
+		put_float(knob.value);
+		return commit(start, knob.module_id, knob.param_id);
+	}
+
+	// set_id may be PatchData::MIDIKnobSet
+	bool add_mapping(uint32_t set_id, MappedKnob const &map) {
+		auto start = pos;
+		put(static_cast<uint8_t>(ParamStreamRecord::Type::Mapping));
+		put_ids(map.module_id, map.param_id);
+		put_varint(ParamStream::encode_set_id(set_id));
+		put_varint(map.panel_knob_id);
+		put(map.curve_type);
+		put(map.midi_chan);
+		put_float(map.min);
+		put_float(map.max);
+		auto len = map.alias_name.length();
+		put(static_cast<uint8_t>(len));
+		for (size_t i = 0; i < len; i++)
+			put(static_cast<uint8_t>(map.alias_name[i]));
+		return commit(start, map.module_id, map.param_id);
+	}
+
+	bool remove_mapping(uint32_t set_id, uint16_t module_id, uint16_t param_id) {
+		auto start = pos;
+		put(static_cast<uint8_t>(ParamStreamRecord::Type::Unmapping));
+		put_ids(module_id, param_id);
+		put_varint(ParamStream::encode_set_id(set_id));
+		return commit(start, module_id, param_id);
+	}
+
+	// Terminates the message and returns the bytes to send.
+	// Returns an empty span if the buffer was too small for the header or the End tag.
+	std::span<const uint8_t> finish() {
+		if (!finished) {
+			put(static_cast<uint8_t>(ParamStreamRecord::Type::End));
+			finished = true;
+		}
+		if (pos > buf.size())
+			return {};
+		return buf.subspan(0, pos);
+	}
+
+	size_t size() const {
+		return pos;
+	}
+
+	// Starts a new message in the same buffer
+	void reset() {
+		pos = 0;
+		prev_module = 0;
+		prev_param = 0;
+		finished = false;
+		put(ParamStream::Magic0);
+		put(ParamStream::Magic1);
+		put(ParamStream::Version);
+	}
+
+private:
+	std::span<uint8_t> buf;
+	size_t pos = 0;
+	uint16_t prev_module = 0;
+	uint16_t prev_param = 0;
+	bool finished = false;
+
+	// Writes past the end are counted but not stored, so a record that
+	// does not fit can be rolled back by commit()
+	void put(uint8_t byte) {
+		if (pos < buf.size())
+			buf[pos] = byte;
+		pos++;
+	}
+
+	void put_varint(uint32_t val) {
+		while (val >= 0x80) {
+			put(static_cast<uint8_t>(val | 0x80));
+			val >>= 7;
+		}
+		put(static_cast<uint8_t>(val));
+	}
+
+	void put_float(float val) {
+		uint32_t bits;
+		std::memcpy(&bits, &val, sizeof bits);
+		put(bits & 0xFF);
+		put((bits >> 8) & 0xFF);
+		put((bits >> 16) & 0xFF);
+		put(bits >> 24);
+	}
+
+	void put_ids(uint16_t module_id, uint16_t param_id) {
+		put_varint(ParamStream::zigzag(int32_t(module_id) - int32_t(prev_module)));
+		put_varint(ParamStream::zigzag(int32_t(param_id) - int32_t(prev_param)));
+	}
+
+	// Leave room for the End tag
+	bool commit(size_t start, uint16_t module_id, uint16_t param_id) {
+		if (finished || pos + 1 > buf.size()) {
+			pos = start;
+			return false;
+		}
+		prev_module = module_id;
+		prev_param = param_id;
+		return true;
+	}
+};
+
+class ParamStreamReader {
+public:
+	explicit ParamStreamReader(std::span<const uint8_t> message)
+		: buf{message} {
+		if (buf.size() < ParamStream::HeaderSize || buf[0] != ParamStream::Magic0 || buf[1] != ParamStream::Magic1 ||
+			buf[2] != ParamStream::Version)
+		{
+			failed = true;
+		}
+		pos = ParamStream::HeaderSize;
+	}
+
+	// Returns false when there are no more records, or the message is malformed.
+	// Check error() to tell the two apart.
+	bool next(ParamStreamRecord &rec) {
+		if (failed || done)
+			return false;
+
+		uint8_t tag;
+		if (!get(tag))
+			return fail();
+
+		rec.type = static_cast<ParamStreamRecord::Type>(tag);
+
+		if (rec.type == ParamStreamRecord::Type::End) {
+			done = true;
+			return false;
+		}
+
+		if (tag > static_cast<uint8_t>(ParamStreamRecord::Type::Unmapping))
+			return fail();
+
+		uint32_t d_module, d_param;
+		if (!get_varint(d_module) || !get_varint(d_param))
+			return fail();
+		prev_module = static_cast<uint16_t>(prev_module + ParamStream::unzigzag(d_module));
+		prev_param = static_cast<uint16_t>(prev_param + ParamStream::unzigzag(d_param));
+		rec.knob.module_id = prev_module;
+		rec.knob.param_id = prev_param;
+		rec.knob.value = 0;
+
+		if (rec.type == ParamStreamRecord::Type::StaticKnob)
+			return get_float(rec.knob.value) || fail();
+
+		uint32_t set;
+		if (!get_varint(set))
+			return fail();
+		rec.set_id = ParamStream::decode_set_id(set);
+
+		if (rec.type == ParamStreamRecord::Type::Unmapping)
+			return true;
+
+		uint32_t panel_knob_id;
+		uint8_t alias_len;
+		if (!get_varint(panel_knob_id) || !get(rec.map.curve_type) || !get(rec.map.midi_chan) ||
+			!get_float(rec.map.min) || !get_float(rec.map.max) || !get(alias_len))
+			return fail();
+
+		if (alias_len >= sizeof(AliasNameString) || buf.size() - pos < alias_len)
+			return fail();
+
+		rec.map.panel_knob_id = static_cast<uint16_t>(panel_knob_id);
+		rec.map.module_id = prev_module;
+		rec.map.param_id = prev_param;
+		rec.map.alias_name.copy({reinterpret_cast<const char *>(&buf[pos]), alias_len});
+		pos += alias_len;
+
+		return true;
+	}
+
+	bool error() const {
+		return failed;
+	}
+
+private:
+	std::span<const uint8_t> buf;
+	size_t pos = 0;
+	uint16_t prev_module = 0;
+	uint16_t prev_param = 0;
+	bool failed = false;
+	bool done = false;
+
+	bool fail() {
+		failed = true;
+		return false;
+	}
+
+	bool get(uint8_t &byte) {
+		if (pos >= buf.size())
+			return false;
+		byte = buf[pos++];
+		return true;
+	}
+
+	bool get_varint(uint32_t &val) {
+		val = 0;
+		for (unsigned shift = 0; shift < 35; shift += 7) {
+			uint8_t byte;
+			if (!get(byte))
+				return false;
+			val |= uint32_t(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	bool get_float(float &val) {
+		if (buf.size() - pos < 4)
+			return false;
+		uint32_t bits = uint32_t(buf[pos]) | (uint32_t(buf[pos + 1]) << 8) | (uint32_t(buf[pos + 2]) << 16) |
+						(uint32_t(buf[pos + 3]) << 24);
+		std::memcpy(&val, &bits, sizeof val);
+		pos += 4;
+		return true;
+	}
+};
+
+// Applies one decoded record to a patch. Returns false if the patch rejected it.
+inline bool apply(ParamStreamRecord const &rec, PatchData &pd) {
+	switch (rec.type) {
+		case ParamStreamRecord::Type::StaticKnob:
+			pd.set_or_add_static_knob_value(rec.knob.module_id, rec.knob.param_id, rec.knob.value);
+			return true;
+
+		case ParamStreamRecord::Type::Mapping:
+			return pd.add_update_mapped_knob(rec.set_id, rec.map);
+
+		case ParamStreamRecord::Type::Unmapping:
+			return pd.remove_mapping(rec.set_id, {.module_id = rec.knob.module_id, .param_id = rec.knob.param_id});
+
+		default:
+			return false;
+	}
+}
+
+// Decodes a whole message into a patch. Returns false if the message is malformed.
+inline bool apply_param_stream(std::span<const uint8_t> message, PatchData &pd) {
+	ParamStreamReader reader{message};
+	ParamStreamRecord rec;
+	while (reader.next(rec))
+		apply(rec, pd);
+	return !reader.error();
+}
+
+} // namespace MetaModule
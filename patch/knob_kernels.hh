@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Knob mapping kernels are written with GCC/Clang vector extensions, which compile to SSE
+// or AVX on x86 and NEON on ARM. Define METAMODULE_KNOB_SCALAR to force the scalar code.
+#if !defined(METAMODULE_KNOB_SCALAR) && defined(__GNUC__)
+#define METAMODULE_KNOB_VECTOR 1
+#else
+#define METAMODULE_KNOB_VECTOR 0
+#endif
+
+namespace MetaModule::KnobMapping
+{
+
+// Same as MappedKnob::get_mapped_val(), with scale = max - min
+inline float map_value(float min, float scale, float panel_val) {
+	return scale * panel_val + min;
+}
+
+// Like MappedKnob::unmap_val(), but multiplies by inv_scale = 1 / (max - min), or 0 if
+// min == max, instead of dividing
+inline float unmap_value(float min, float inv_scale, float mapped_val) {
+	return (mapped_val - min) * inv_scale;
+}
+
+inline float inverse_scale(float scale) {
+	return scale == 0.f ? 0.f : 1.f / scale;
+}
+
+#if METAMODULE_KNOB_VECTOR
+
+typedef float f32x4 __attribute__((vector_size(16)));
+
+inline f32x4 load4(const float *p) {
+	f32x4 v;
+	std::memcpy(&v, p, sizeof v);
+	return v;
+}
+
+inline void store4(float *p, f32x4 v) {
+	std::memcpy(p, &v, sizeof v);
+}
+
+#endif
+
+// out[i] = map_value(min[i], scale[i], panel_vals[i]) for i < n.
+// out may alias panel_vals.
+inline void map_values(const float *min, const float *scale, const float *panel_vals, float *out, size_t n) {
+	size_t i = 0;
+
+#if METAMODULE_KNOB_VECTOR
+	for (size_t end = n & ~size_t(3); i < end; i += 4)
+		store4(out + i, load4(scale + i) * load4(panel_vals + i) + load4(min + i));
+#endif
+
+	for (; i < n; i++)
+		out[i] = map_value(min[i], scale[i], panel_vals[i]);
+}
+
+// out[i] = unmap_value(min[i], inv_scale[i], mapped_vals[i]) for i < n.
+// out may alias mapped_vals.
+inline void unmap_values(const float *min, const float *inv_scale, const float *mapped_vals, float *out, size_t n) {
+	size_t i = 0;
+
+#if METAMODULE_KNOB_VECTOR
+	for (size_t end = n & ~size_t(3); i < end; i += 4)
+		store4(out + i, (load4(mapped_vals + i) - load4(min + i)) * load4(inv_scale + i));
+#endif
+
+	for (; i < n; i++)
+		out[i] = unmap_value(min[i], inv_scale[i], mapped_vals[i]);
+}
+
+} // namespace MetaModule::KnobMapping
@@ -0,0 +1,237 @@
+#pragma once
+#include "knob_kernels.hh"
+#include "patch_data.hh"
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+namespace MetaModule
+{
+
+// The knob sets of a patch, compiled for the per-block mapping loop and for switching
+// between sets.
+//
+// The mappings of every set are flattened into parallel arrays, sorted by panel knob
+// within each set. Alias names and curve types are left out: values are mapped like
+// MappedKnob::get_mapped_val(), which ignores the curve type. For each pair of sets,
+// the plan lists the mappings of the new set for params whose mappings differ in the
+// old one, and the params only the old set maps, so a switch touches just those.
+class KnobSetPlan {
+public:
+	struct Param {
+		uint16_t module_id;
+		uint16_t param_id;
+		bool operator==(Param const &) const = default;
+	};
+
+	struct Set {
+		std::span<const uint16_t> panel_knob_id;
+		std::span<const uint16_t> module_id;
+		std::span<const uint16_t> param_id;
+		std::span<const float> min;
+		std::span<const float> scale;	  // max - min
+		std::span<const float> inv_scale; // 1 / (max - min), or 0 if min == max
+
+		size_t size() const {
+			return panel_knob_id.size();
+		}
+	};
+
+	struct Delta {
+		std::span<const uint16_t> changed; // indices into the new set
+		std::span<const Param> released;  // params mapped by the old set but not the new one
+	};
+
+	KnobSetPlan() = default;
+
+	explicit KnobSetPlan(PatchData const &pd) {
+		build(pd);
+	}
+
+	// Compiles pd.knob_sets. MIDI maps are not included.
+	void build(PatchData const &pd) {
+		*this = {};
+
+		set_offsets.push_back(0);
+		for (auto const &knob_set : pd.knob_sets) {
+			std::vector<uint32_t> order(knob_set.set.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+				return knob_set.set[a].panel_knob_id < knob_set.set[b].panel_knob_id;
+			});
+
+			for (auto idx : order) {
+				auto const &m = knob_set.set[idx];
+				panel_knob_ids.push_back(m.panel_knob_id);
+				module_ids.push_back(m.module_id);
+				param_ids.push_back(m.param_id);
+				mins.push_back(m.min);
+				scales.push_back(m.max - m.min);
+				inv_scales.push_back(KnobMapping::inverse_scale(scales.back()));
+			}
+			set_offsets.push_back(uint32_t(panel_knob_ids.size()));
+		}
+
+		auto n = num_sets();
+		changed_offsets.push_back(0);
+		released_offsets.push_back(0);
+		for (unsigned from = 0; from < n; from++) {
+			for (unsigned to = 0; to < n; to++) {
+				build_delta(from, to);
+				changed_offsets.push_back(uint32_t(changed.size()));
+				released_offsets.push_back(uint32_t(released.size()));
+			}
+		}
+	}
+
+	size_t num_sets() const {
+		return set_offsets.empty() ? 0 : set_offsets.size() - 1;
+	}
+
+	Set set(unsigned set_id) const {
+		if (set_id >= num_sets())
+			return {};
+
+		auto first = set_offsets[set_id];
+		auto count = set_offsets[set_id + 1] - first;
+		return {
+			.panel_knob_id = std::span{panel_knob_ids}.subspan(first, count),
+			.module_id = std::span{module_ids}.subspan(first, count),
+			.param_id = std::span{param_ids}.subspan(first, count),
+			.min = std::span{mins}.subspan(first, count),
+			.scale = std::span{scales}.subspan(first, count),
+			.inv_scale = std::span{inv_scales}.subspan(first, count),
+		};
+	}
+
+	Delta delta(unsigned from, unsigned to) const {
+		if (from >= num_sets() || to >= num_sets())
+			return {};
+
+		auto pair = from * num_sets() + to;
+		return {
+			.changed = std::span{changed}.subspan(changed_offsets[pair],
+												  changed_offsets[pair + 1] - changed_offsets[pair]),
+			.released = std::span{released}.subspan(released_offsets[pair],
+													released_offsets[pair + 1] - released_offsets[pair]),
+		};
+	}
+
+	// Maps a block of panel values (indexed by panel knob id) through every mapping of the
+	// set, writing out[i] for mapping i. Mappings of knobs past the end of panel_vals
+	// read 0. out must hold set(set_id).size() values.
+	void map(unsigned set_id, std::span<const float> panel_vals, std::span<float> out) const {
+		auto s = set(set_id);
+		if (out.size() < s.size())
+			return;
+
+		for (size_t i = 0; i < s.size(); i++)
+			out[i] = s.panel_knob_id[i] < panel_vals.size() ? panel_vals[s.panel_knob_id[i]] : 0.f;
+
+		KnobMapping::map_values(s.min.data(), s.scale.data(), out.data(), out.data(), s.size());
+	}
+
+	// The panel value that gives each param value, for mapping i of the set.
+	// mapped_vals and out must hold set(set_id).size() values, and may be the same.
+	void unmap(unsigned set_id, std::span<const float> mapped_vals, std::span<float> out) const {
+		auto s = set(set_id);
+		if (mapped_vals.size() < s.size() || out.size() < s.size())
+			return;
+
+		KnobMapping::unmap_values(s.min.data(), s.inv_scale.data(), mapped_vals.data(), out.data(), s.size());
+	}
+
+	// Calls func(module_id, param_id, value) for each mapping of the set. panel_vals is
+	// indexed by panel knob id; mappings of knobs past its end are skipped.
+	template<typename F>
+	void apply(unsigned set_id, std::span<const float> panel_vals, F &&func) const {
+		auto s = set(set_id);
+		for (size_t i = 0; i < s.size(); i++) {
+			if (s.panel_knob_id[i] < panel_vals.size())
+				func(s.module_id[i],
+					 s.param_id[i],
+					 KnobMapping::map_value(s.min[i], s.scale[i], panel_vals[s.panel_knob_id[i]]));
+		}
+	}
+
+	// Calls func(module_id, param_id, value) for just the mappings that change when
+	// switching from one set to another
+	template<typename F>
+	void apply_switch(unsigned from, unsigned to, std::span<const float> panel_vals, F &&func) const {
+		auto s = set(to);
+		for (auto i : delta(from, to).changed) {
+			if (s.panel_knob_id[i] < panel_vals.size())
+				func(s.module_id[i],
+					 s.param_id[i],
+					 KnobMapping::map_value(s.min[i], s.scale[i], panel_vals[s.panel_knob_id[i]]));
+		}
+	}
+
+private:
+	void build_delta(unsigned from, unsigned to) {
+		auto a = set(from);
+		auto b = set(to);
+
+		auto same_mapping = [&](size_t i, size_t j) {
+			return a.panel_knob_id[i] == b.panel_knob_id[j] && a.module_id[i] == b.module_id[j] &&
+				   a.param_id[i] == b.param_id[j] && a.min[i] == b.min[j] && a.scale[i] == b.scale[j];
+		};
+
+		// A param mapped to more than one knob ends up with the value of its last
+		// mapping, so its mappings are unchanged only if they're all the same
+		auto same_param_mappings = [&](Param p) {
+			auto maps_p = [&](Set const &s, size_t i) {
+				return s.module_id[i] == p.module_id && s.param_id[i] == p.param_id;
+			};
+
+			size_t i = 0;
+			size_t j = 0;
+			while (true) {
+				while (i < a.size() && !maps_p(a, i))
+					i++;
+				while (j < b.size() && !maps_p(b, j))
+					j++;
+				if (i == a.size() || j == b.size())
+					return i == a.size() && j == b.size();
+				if (!same_mapping(i++, j++))
+					return false;
+			}
+		};
+
+		for (size_t j = 0; j < b.size(); j++) {
+			if (!same_param_mappings({b.module_id[j], b.param_id[j]}))
+				changed.push_back(uint16_t(j));
+		}
+
+		for (size_t i = 0; i < a.size(); i++) {
+			Param p{a.module_id[i], a.param_id[i]};
+
+			bool still_mapped = false;
+			for (size_t j = 0; j < b.size() && !still_mapped; j++)
+				still_mapped = Param{b.module_id[j], b.param_id[j]} == p;
+
+			auto first = released.begin() + released_offsets.back();
+			if (!still_mapped && std::find(first, released.end(), p) == released.end())
+				released.push_back(p);
+		}
+	}
+
+	// All sets, one after another
+	std::vector<uint16_t> panel_knob_ids;
+	std::vector<uint16_t> module_ids;
+	std::vector<uint16_t> param_ids;
+	std::vector<float> mins;
+	std::vector<float> scales;
+	std::vector<float> inv_scales;
+	std::vector<uint32_t> set_offsets;
+
+	// Per (from, to) pair, from * num_sets() + to
+	std::vector<uint16_t> changed;
+	std::vector<uint32_t> changed_offsets;
+	std::vector<Param> released;
+	std::vector<uint32_t> released_offsets;
+};
+
+} // namespace MetaModule
@@ -0,0 +1,205 @@
+#pragma once
+#include "patch_data.hh"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace MetaModule
+{
+
+// Lists of the MIDI maps driven by each CC (plus pitch wheel) and each note-gate,
+// compiled from PatchData::midi_maps. An incoming message finds its maps by indexing,
+// instead of searching midi_maps.set.
+//
+// CCs 0-31 can be paired with CCs 32-63 as 14-bit MSB/LSB controllers. Pairing is off
+// by default, since many controllers send unrelated messages on CCs 32-63; once a CC is
+// paired with pair_cc(), and as long as its LSB CC isn't mapped itself, an LSB message
+// refines the value of the MSB CC's maps.
+class MidiDispatchTable {
+public:
+	struct Target {
+		uint16_t module_id;
+		uint16_t param_id;
+		uint8_t curve_type;
+		uint8_t midi_chan; //0: any channel, 1-16: only this channel
+		float min;
+		float max;
+
+		float get_mapped_val(float panel_val) const {
+			return (max - min) * panel_val + min;
+		}
+	};
+
+	MidiDispatchTable() = default;
+
+	explicit MidiDispatchTable(PatchData const &pd) {
+		build(pd);
+	}
+
+	void build(PatchData const &pd) {
+		for (unsigned slot = 0; slot < NumSlots; slot++)
+			rebuild_slot(pd, slot);
+		msb = {};
+	}
+
+	// Updates pd like PatchData::add_update_midi_map(), and rebuilds only the lists
+	// of the map's old and new CC or note
+	bool add_update_midi_map(PatchData &pd, MappedKnob const &map) {
+		auto old_slot = find_slot(pd, map);
+
+		if (!pd.add_update_midi_map(map))
+			return false;
+
+		if (old_slot)
+			rebuild_slot(pd, *old_slot);
+		if (auto new_slot = slot_of(map.panel_knob_id); new_slot && new_slot != old_slot)
+			rebuild_slot(pd, *new_slot);
+		return true;
+	}
+
+	bool remove_midi_map(PatchData &pd, MappedKnob const &map) {
+		auto old_slot = find_slot(pd, map);
+
+		if (!pd.remove_mapping(PatchData::MIDIKnobSet, map))
+			return false;
+
+		if (old_slot)
+			rebuild_slot(pd, *old_slot);
+		return true;
+	}
+
+	// Maps driven by CC 0-127, or PitchBendCC for the pitch wheel
+	std::span<const Target> cc_targets(unsigned cc) const {
+		return cc < NumMidiCCsPW ? std::span<const Target>{lists[cc]} : std::span<const Target>{};
+	}
+
+	std::span<const Target> notegate_targets(unsigned note) const {
+		return note < NumMidiNotes ? std::span<const Target>{lists[NoteSlot0 + note]} : std::span<const Target>{};
+	}
+
+	// Calls func(target, value) for each map of a CC message on MIDI channel chan (1-16).
+	// value is 14-bit: a 7-bit value is shifted up by 7, as the M4 core sends it.
+	// Returns the number of maps called.
+	template<typename F>
+	unsigned dispatch_cc(unsigned chan, unsigned cc, uint8_t val, F &&func) {
+		if (chan < 1 || chan > 16 || cc >= NumMidiCCs)
+			return 0;
+
+		val &= 0x7F;
+		uint16_t value = val << 7;
+
+		if (cc < NumPairedCCs) {
+			msb[chan - 1][cc] = val;
+
+		} else if (cc < 2 * NumPairedCCs && is_paired(cc - NumPairedCCs)) {
+			cc -= NumPairedCCs;
+			value = (msb[chan - 1][cc] << 7) | val;
+		}
+
+		return dispatch(cc, chan, value, func);
+	}
+
+	// Calls func(target, value) for each map of the pitch wheel, with the 14-bit value
+	template<typename F>
+	unsigned dispatch_pitchwheel(unsigned chan, uint16_t value, F &&func) {
+		if (chan < 1 || chan > 16)
+			return 0;
+		return dispatch(Midi::PitchBendCC, chan, value & 0x3FFF, func);
+	}
+
+	// Calls func(target) for each note-gate map of a note message
+	template<typename F>
+	unsigned dispatch_notegate(unsigned chan, unsigned note, F &&func) {
+		if (chan < 1 || chan > 16 || note >= NumMidiNotes)
+			return 0;
+
+		auto gate = [&func](Target const &t, uint16_t) { func(t); };
+		return dispatch(NoteSlot0 + note, chan, 0, gate);
+	}
+
+	// Treats CC cc + 32 as the LSB of CC cc (0-31) or stops doing so. Kept by build().
+	void pair_cc(unsigned cc, bool paired = true) {
+		if (cc >= NumPairedCCs)
+			return;
+
+		if (paired)
+			paired_ccs |= 1u << cc;
+		else
+			paired_ccs &= ~(1u << cc);
+
+		for (auto &chan_msb : msb)
+			chan_msb[cc] = 0;
+	}
+
+	// True if an LSB CC (cc + 32) refines this CC's maps
+	bool is_paired(unsigned cc) const {
+		return cc < NumPairedCCs && (paired_ccs & (1u << cc)) && !lists[cc].empty() &&
+			   lists[cc + NumPairedCCs].empty();
+	}
+
+private:
+	static constexpr unsigned NumPairedCCs = 32;
+	static constexpr unsigned NoteSlot0 = NumMidiCCsPW;
+	static constexpr unsigned NumSlots = NumMidiCCsPW + NumMidiNotes;
+
+	static std::optional<unsigned> slot_of(uint16_t panel_knob_id) {
+		if (panel_knob_id >= MidiCC0 && panel_knob_id <= MidiPitchWheelJack)
+			return panel_knob_id - MidiCC0;
+		if (panel_knob_id >= MidiGateNote0 && panel_knob_id <= MidiGateNote127)
+			return NoteSlot0 + panel_knob_id - MidiGateNote0;
+		return std::nullopt;
+	}
+
+	static std::optional<unsigned> find_slot(PatchData const &pd, MappedKnob const &map) {
+		if (auto *old = pd.find_midi_map(map.module_id, map.param_id))
+			return slot_of(old->panel_knob_id);
+		return std::nullopt;
+	}
+
+	// Lists keep the order of midi_maps.set, so an incremental update gives the same
+	// table as build()
+	void rebuild_slot(PatchData const &pd, unsigned slot) {
+		auto &list = lists[slot];
+		list.clear();
+		channels[slot] = 0;
+
+		for (auto const &m : pd.midi_maps.set) {
+			if (slot_of(m.panel_knob_id) != slot)
+				continue;
+
+			list.push_back({m.module_id, m.param_id, m.curve_type, m.midi_chan, m.min, m.max});
+			channels[slot] |= (m.midi_chan >= 1 && m.midi_chan <= 16) ? uint16_t(1u << (m.midi_chan - 1)) : 0xFFFF;
+		}
+	}
+
+	template<typename F>
+	unsigned dispatch(unsigned slot, unsigned chan, uint16_t value, F &func) {
+		// Most messages are for channels or CCs nothing is mapped to
+		if (!(channels[slot] & (1u << (chan - 1))))
+			return 0;
+
+		unsigned count = 0;
+		for (auto const &t : lists[slot]) {
+			if (t.midi_chan == 0 || t.midi_chan == chan) {
+				func(t, value);
+				count++;
+			}
+		}
+		return count;
+	}
+
+	std::array<std::vector<Target>, NumSlots> lists{};
+
+	// Bit n set if a map in the list listens to channel n+1
+	std::array<uint16_t, NumSlots> channels{};
+
+	// Bit n set if CC n was paired with pair_cc()
+	uint32_t paired_ccs = 0;
+
+	// Last MSB of each pairable CC, per channel
+	std::array<std::array<uint8_t, NumPairedCCs>, 16> msb{};
+};
+
+} // namespace MetaModule
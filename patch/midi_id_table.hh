@@ -0,0 +1,228 @@
+#pragma once
+#include "midi_def.hh"
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace MetaModule::Midi
+{
+
+enum class EventType : uint8_t { None, Note, CC, GateNote, Clock, Transport };
+
+// Everything the classifiers in midi_def.hh derive from a panel jack id, decoded once and
+// packed in 32 bits. Look it up with id_info(), instead of running the range checks:
+//
+//   bits 0-7:   num: poly channel index, CC, note, clock division or transport event
+//   bits 8-11:  poly channel 1-8, or 0
+//   bits 12-14: note event: 0=Note, 1=Gate, 2=Vel, 3=Aft, 4=Retrig
+//   bit 15:     the id is a jack of its event type (num and note event are valid)
+//   bits 16-18: EventType
+//   bit 19:     poly cable
+//   bit 20:     poly channels 5-8 cable
+//   bit 21:     the channel bits of the id are used
+class IdInfo {
+public:
+	constexpr IdInfo() = default;
+
+	// Decodes an id without channel bits
+	static constexpr IdInfo decode(uint32_t id) {
+		IdInfo info;
+		if (id >= 0x800)
+			return info;
+
+		if (id < 0x400)
+			info.bits |= ChannelUsed;
+
+		if (id < MidiMonoNoteJack || id >= LastMidiJack)
+			return info;
+
+		auto type = EventType((id >> 8) & 0x7);
+		info.bits |= uint32_t(type) << 16;
+
+		auto lo = id & 0xFF;
+
+		switch (type) {
+			case EventType::Note:
+				if (id < MidiNotePolyJack) {
+					info.bits |= (std::min<uint32_t>(lo & 0x0F, 7) + 1) << 8;
+					if ((lo >> 4) <= NumNoteEvents - 1 && (lo & 0x0F) < MaxMidiPolyphony)
+						info.set_num(lo & 0x0F, lo >> 4);
+
+				} else if (id <= MidiRetrigPolyJack) {
+					info.bits |= PolyCable;
+					info.set_num(0, id - MidiNotePolyJack);
+
+				} else if (id <= MidiRetrigPoly5_8Jack) {
+					info.bits |= PolyCable | Poly5_8Cable;
+					info.set_num(0, id - MidiNotePoly5_8Jack);
+				}
+				break;
+
+			case EventType::CC:
+				if (id <= MidiPitchWheelJack)
+					info.set_num(lo);
+				break;
+
+			case EventType::GateNote:
+				if (id <= MidiGateNote127)
+					info.set_num(lo);
+				break;
+
+			case EventType::Clock:
+				if (id <= MidiClockDiv96Jack)
+					info.set_num(lo);
+				break;
+
+			case EventType::Transport:
+				info.set_num(lo);
+				break;
+
+			default:
+				break;
+		}
+		return info;
+	}
+
+	constexpr EventType type() const {
+		return EventType((bits >> 16) & 0x7);
+	}
+
+	// Same as is_midi_panel_id()
+	constexpr bool is_midi() const {
+		return type() != EventType::None;
+	}
+
+	// Same as midi_channel(), given the id with its channel bits
+	constexpr uint32_t channel(uint32_t panel_jack_id) const {
+		return ((panel_jack_id & 0x0800) && (bits & ChannelUsed)) ? ((panel_jack_id >> 12) & 0xF) + 1 : 0;
+	}
+
+	constexpr std::optional<uint8_t> polychan() const {
+		if (auto chan = (bits >> 8) & 0xF)
+			return uint8_t(chan);
+		return std::nullopt;
+	}
+
+	constexpr bool is_poly_cable() const {
+		return bits & PolyCable;
+	}
+
+	constexpr bool is_poly5_8_cable() const {
+		return bits & Poly5_8Cable;
+	}
+
+	// Poly channel the cable's first channel carries: 0, or MidiPolyCableChanBase
+	constexpr uint8_t poly_cable_base() const {
+		return is_poly5_8_cable() ? MidiPolyCableChanBase : 0;
+	}
+
+	constexpr std::optional<uint8_t> poly_cable_event() const {
+		if (is_poly_cable())
+			return note_event();
+		return std::nullopt;
+	}
+
+	constexpr std::optional<uint32_t> note_pitch() const {
+		return mono_note(0);
+	}
+
+	constexpr std::optional<uint32_t> note_gate() const {
+		return mono_note(1);
+	}
+
+	constexpr std::optional<uint32_t> note_vel() const {
+		return mono_note(2);
+	}
+
+	constexpr std::optional<uint32_t> note_aft() const {
+		return mono_note(3);
+	}
+
+	constexpr std::optional<uint32_t> note_retrig() const {
+		return mono_note(4);
+	}
+
+	// CC 0-127, or PitchBendCC
+	constexpr std::optional<uint32_t> cc() const {
+		return of_type(EventType::CC);
+	}
+
+	// Note of a gate note jack
+	constexpr std::optional<uint32_t> gate() const {
+		return of_type(EventType::GateNote);
+	}
+
+	// Clock division: 0 for the undivided clock, else 24ppqn pulses per output pulse
+	constexpr std::optional<uint32_t> clock_div() const {
+		return of_type(EventType::Clock);
+	}
+
+	// Same as midi_clk()
+	constexpr std::optional<uint32_t> clk() const {
+		return clock_div() == 0u ? std::optional<uint32_t>{0} : std::nullopt;
+	}
+
+	// Same as midi_divclk(): the offset from MidiClockDiv1Jack
+	constexpr std::optional<uint32_t> divclk() const {
+		if (auto div = clock_div(); div && *div > 0)
+			return *div - 1;
+		return std::nullopt;
+	}
+
+	// 0=Start, 1=Stop, 2=Continue
+	constexpr std::optional<uint32_t> transport() const {
+		return of_type(EventType::Transport);
+	}
+
+	constexpr uint32_t packed() const {
+		return bits;
+	}
+
+private:
+	static constexpr uint32_t NumNoteEvents = 5;
+	static constexpr uint32_t IsJack = 1u << 15;
+	static constexpr uint32_t PolyCable = 1u << 19;
+	static constexpr uint32_t Poly5_8Cable = 1u << 20;
+	static constexpr uint32_t ChannelUsed = 1u << 21;
+
+	constexpr void set_num(uint32_t num, uint32_t note_event = 0) {
+		bits |= IsJack | (note_event << 12) | num;
+	}
+
+	constexpr uint8_t note_event() const {
+		return (bits >> 12) & 0x7;
+	}
+
+	constexpr std::optional<uint32_t> of_type(EventType t) const {
+		if (type() == t && (bits & IsJack))
+			return bits & 0xFF;
+		return std::nullopt;
+	}
+
+	constexpr std::optional<uint32_t> mono_note(uint8_t event) const {
+		if (!is_poly_cable() && note_event() == event)
+			return of_type(EventType::Note);
+		return std::nullopt;
+	}
+
+	uint32_t bits = 0;
+};
+
+inline constexpr auto IdTable = [] {
+	std::array<IdInfo, 0x800> table{};
+	for (uint32_t id = 0; id < table.size(); id++)
+		table[id] = IdInfo::decode(id);
+	return table;
+}();
+
+constexpr IdInfo id_info(uint32_t panel_jack_id) {
+	return IdTable[strip_midi_channel(panel_jack_id)];
+}
+
+static_assert(sizeof(IdInfo) == 4);
+static_assert(id_info(MidiNote3Jack).note_pitch() == 2u);
+static_assert(id_info(MidiGatePoly5_8Jack).poly_cable_base() == MidiPolyCableChanBase);
+static_assert(id_info(MidiCC0 + 74).cc() == 74u);
+static_assert(id_info(MidiClockDiv24Jack).clock_div() == 24u);
+
+} // namespace MetaModule::Midi
@@ -0,0 +1,175 @@
+#pragma once
+#include "patch_data.hh"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace MetaModule
+{
+
+// The jacks fed by each MIDI event, compiled from PatchData::mapped_ins.
+//
+// Events are keyed by their panel jack id without the channel bits: the event type,
+// then the poly channel, CC, note, clock division or transport event (see midi_def.hh).
+// The jacks of each key are grouped by the MIDI channel they listen to, so a message
+// finds its jacks with two array lookups, and nothing is decoded per event.
+class MidiJackRouter {
+public:
+	static constexpr unsigned NumIds = 0x800;
+
+	// Jacks that listen to any channel, and jacks that listen to the message's channel
+	struct Route {
+		std::span<const Jack> omni;
+		std::span<const Jack> channel;
+
+		size_t size() const {
+			return omni.size() + channel.size();
+		}
+
+		bool empty() const {
+			return size() == 0;
+		}
+
+		template<typename F>
+		void for_each(F &&func) const {
+			for (auto const &jack : omni)
+				func(jack);
+			for (auto const &jack : channel)
+				func(jack);
+		}
+	};
+
+	MidiJackRouter() {
+		slots.fill(NoSlot);
+	}
+
+	explicit MidiJackRouter(PatchData const &pd)
+		: MidiJackRouter{} {
+		build(pd);
+	}
+
+	void build(PatchData const &pd) {
+		struct Dest {
+			uint16_t id;
+			uint8_t chan;
+			Jack jack;
+		};
+
+		std::vector<Dest> dests;
+		for (auto const &map : pd.mapped_ins) {
+			if (!Midi::is_midi_panel_id(map.panel_jack_id))
+				continue;
+			auto id = uint16_t(Midi::strip_midi_channel(map.panel_jack_id));
+			auto chan = uint8_t(Midi::midi_channel(map.panel_jack_id));
+			for (auto const &jack : map.ins)
+				dests.push_back({id, chan, jack});
+		}
+
+		// Stable, so each group keeps the order of mapped_ins
+		std::stable_sort(dests.begin(), dests.end(), [](Dest const &a, Dest const &b) {
+			return a.id < b.id || (a.id == b.id && a.chan < b.chan);
+		});
+
+		slots.fill(NoSlot);
+		ids.clear();
+		offsets.clear();
+		jacks.clear();
+		jacks.reserve(dests.size());
+
+		auto d = dests.begin();
+		while (d != dests.end()) {
+			auto id = d->id;
+			slots[id] = uint16_t(ids.size());
+			ids.push_back(id);
+
+			for (unsigned chan = 0; chan < NumGroups; chan++) {
+				offsets.push_back(uint32_t(jacks.size()));
+				for (; d != dests.end() && d->id == id && d->chan == chan; d++)
+					jacks.push_back(d->jack);
+			}
+		}
+		offsets.push_back(uint32_t(jacks.size()));
+	}
+
+	// Jacks fed by an event on MIDI channel chan (1-16). id is a panel jack id without
+	// channel bits, e.g. MidiCC0 + cc or MidiClockDiv6Jack.
+	Route route(uint16_t id, unsigned chan) const {
+		if (id >= NumIds || slots[id] == NoSlot)
+			return {};
+
+		auto *group = &offsets[slots[id] * NumGroups];
+		Route r{group_span(group, 0), {}};
+		if (chan >= 1 && chan <= 16)
+			r.channel = group_span(group, chan);
+		return r;
+	}
+
+	Route note_pitch(unsigned polychan, unsigned chan) const {
+		return polychan < MaxMidiPolyphony ? route(uint16_t(MidiMonoNoteJack + polychan), chan) : Route{};
+	}
+
+	Route note_gate(unsigned polychan, unsigned chan) const {
+		return polychan < MaxMidiPolyphony ? route(uint16_t(MidiMonoGateJack + polychan), chan) : Route{};
+	}
+
+	Route note_vel(unsigned polychan, unsigned chan) const {
+		return polychan < MaxMidiPolyphony ? route(uint16_t(MidiMonoVelJack + polychan), chan) : Route{};
+	}
+
+	Route note_aft(unsigned polychan, unsigned chan) const {
+		return polychan < MaxMidiPolyphony ? route(uint16_t(MidiMonoAftertouchJack + polychan), chan) : Route{};
+	}
+
+	Route note_retrig(unsigned polychan, unsigned chan) const {
+		return polychan < MaxMidiPolyphony ? route(uint16_t(MidiMonoRetrigJack + polychan), chan) : Route{};
+	}
+
+	// event: 0=Note, 1=Gate, 2=Vel, 3=Aft, 4=Retrig (see Midi::midi_poly_cable_event)
+	Route poly_cable(unsigned event, bool poly5_8, unsigned chan) const {
+		auto first = poly5_8 ? MidiNotePoly5_8Jack : MidiNotePolyJack;
+		return event <= (MidiRetrigPolyJack - MidiNotePolyJack) ? route(uint16_t(first + event), chan) : Route{};
+	}
+
+	// cc: 0-127, or Midi::PitchBendCC for the pitch wheel
+	Route cc(unsigned cc, unsigned chan) const {
+		return cc < NumMidiCCsPW ? route(uint16_t(MidiCC0 + cc), chan) : Route{};
+	}
+
+	Route gate_note(unsigned note, unsigned chan) const {
+		return note < NumMidiNotes ? route(uint16_t(MidiGateNote0 + note), chan) : Route{};
+	}
+
+	// div: 0 for the undivided clock, or the division in 24ppqn pulses
+	Route clock(unsigned div) const {
+		return div < NumMidiClockJacks ? route(uint16_t(MidiClockJack + div), 0) : Route{};
+	}
+
+	// event: 0=Start, 1=Stop, 2=Continue
+	Route transport(unsigned event) const {
+		return event <= (MidiContinueJack - MidiStartJack) ? route(uint16_t(MidiStartJack + event), 0) : Route{};
+	}
+
+	// Ids that feed at least one jack, in order. E.g. the clock divisions to generate.
+	std::span<const uint16_t> used_ids() const {
+		return ids;
+	}
+
+private:
+	static constexpr uint16_t NoSlot = 0xFFFF;
+	static constexpr unsigned NumGroups = 17; // omni, then channels 1-16
+
+	std::span<const Jack> group_span(const uint32_t *group, unsigned chan) const {
+		return std::span<const Jack>{jacks}.subspan(group[chan], group[chan + 1] - group[chan]);
+	}
+
+	// Index into ids for each id, or NoSlot
+	std::array<uint16_t, NumIds> slots;
+
+	std::vector<uint16_t> ids;
+	std::vector<uint32_t> offsets; // NumGroups per id, and one past the end
+	std::vector<Jack> jacks;
+};
+
+} // namespace MetaModule
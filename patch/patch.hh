@@ -5,6 +5,7 @@
 #include "util/static_string.hh"
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 constexpr unsigned MaxKnobSets = 8;
@@ -123,6 +124,27 @@ struct MappedOutputJack {
 struct ModuleInitState {
 	uint32_t module_id{};
 	std::string state_data;
+
+	// Opt-in, with PatchLoadOptions::retain_source: the state as a view into the yaml
+	// buffer, set instead of state_data. The buffer must outlive this object, and copies
+	// of it, which share the view. Assigning non-empty state_data replaces the view.
+	std::string_view state_view{};
+
+	bool is_view() const {
+		return state_data.empty() && state_view.data();
+	}
+
+	std::string_view data() const {
+		return is_view() ? state_view : std::string_view{state_data};
+	}
+
+	// Copies a retained view into state_data, so it can be modified
+	std::string &mutable_data() {
+		if (is_view())
+			state_data = state_view;
+		state_view = {};
+		return state_data;
+	}
 };
 
 struct ModuleAlias {
@@ -227,14 +227,14 @@ struct PatchData {
 			std::erase(cable.ins, jack);
 		}
 		// Remove any cables that now have no inputs
-		std::erase_if(int_cables, [](auto cable) { return (cable.ins.size() == 0); });
+		std::erase_if(int_cables, [](auto const &cable) { return (cable.ins.size() == 0); });
 
 		remove_injack_mappings(jack);
 	}
 
 	void disconnect_outjack(Jack jack) {
 		// Remove any cables with this output
-		std::erase_if(int_cables, [jack](auto cable) { return (cable.out == jack); });
+		std::erase_if(int_cables, [jack](auto const &cable) { return (cable.out == jack); });
 
 		remove_outjack_mappings(jack);
 	}
@@ -245,14 +245,14 @@ struct PatchData {
 			std::erase(map.ins, jack);
 		}
 		// Remove any panel mappings that now have no inputs
-		std::erase_if(mapped_ins, [](auto map) { return (map.ins.size() == 0); });
+		std::erase_if(mapped_ins, [](auto const &map) { return (map.ins.size() == 0); });
 
 		update_midi_poly_num();
 	}
 
 	void remove_outjack_mappings(Jack jack) {
 		// Remove any panel mappings with this output
-		std::erase_if(mapped_outs, [jack](auto map) { return (map.out == jack); });
+		std::erase_if(mapped_outs, [jack](auto const &map) { return (map.out == jack); });
 	}
 
 	const MappedInputJack *find_mapped_midi_injack(Jack jack) const {
@@ -445,20 +445,18 @@ struct PatchData {
 
 		// Squash all module ids down:
 
-		std::transform(int_cables.begin(), int_cables.end(), int_cables.begin(), [=](InternalCable &cable) {
+		// Modify in place: returning a cable from std::transform would copy its ins
+		for (auto &cable : int_cables) {
 			if (cable.out.module_id > module_id) {
 				cable.out.module_id--;
 			}
 
-			std::transform(cable.ins.begin(), cable.ins.end(), cable.ins.begin(), [=](Jack &jack) {
+			for (auto &jack : cable.ins) {
 				if (jack.module_id > module_id) {
 					jack.module_id--;
 				}
-				return jack;
-			});
-
-			return cable;
-		});
+			}
+		}
 
 		for (auto &map : mapped_ins) {
 			std::transform(map.ins.begin(), map.ins.end(), map.ins.begin(), [=](Jack &in) {
@@ -499,12 +497,11 @@ struct PatchData {
 			return map;
 		});
 
-		std::transform(module_states.begin(), module_states.end(), module_states.begin(), [=](ModuleInitState &state) {
+		for (auto &state : module_states) {
 			if (state.module_id > module_id) {
 				state.module_id--;
 			}
-			return state;
-		});
+		}
 
 		for (auto &id : bypassed_modules) {
 			if (id > module_id)
@@ -534,8 +531,8 @@ struct PatchData {
 		for (MappedInputJack &map : mapped_ins) {
 			std::erase_if(map.ins, [=](Jack in) { return in.module_id == module_id; });
 		}
-		std::erase_if(mapped_ins, [=](MappedInputJack map) { return map.ins.size() == 0; });
-		std::erase_if(mapped_outs, [=](MappedOutputJack map) { return map.out.module_id == module_id; });
+		std::erase_if(mapped_ins, [=](MappedInputJack const &map) { return map.ins.size() == 0; });
+		std::erase_if(mapped_outs, [=](MappedOutputJack const &map) { return map.out.module_id == module_id; });
 
 		std::erase_if(static_knobs, [=](StaticParam &knob) { return knob.module_id == module_id; });
 
@@ -0,0 +1,306 @@
+#pragma once
+#include "patch_data.hh"
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace MetaModule
+{
+
+// Canonical content hash of a PatchData.
+//
+// Elements of a section are combined with a wrapping sum, so the order of cables,
+// inputs on a cable, mappings within a knob set, static knobs, lights, states,
+// bypassed modules and aliases does not change the hash. Module slugs and the order
+// of knob sets are significant, since ids refer to their positions.
+//
+// Because sections are sums, a PatchHasher can be kept up to date as a patch is
+// edited: remove() the old element and add() the new one, instead of rehashing.
+namespace PatchHash
+{
+
+constexpr uint64_t mix(uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+// Order-sensitive combine
+constexpr uint64_t combine(uint64_t seed, uint64_t val) {
+	return mix(seed + 0x9e3779b97f4a7c15ULL + val);
+}
+
+constexpr uint64_t hash_bytes(std::string_view bytes) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (char c : bytes) {
+		h ^= static_cast<uint8_t>(c);
+		h *= 0x100000001b3ULL;
+	}
+	return mix(h ^ bytes.size());
+}
+
+inline uint64_t hash(float f) {
+	if (f == 0.f)
+		f = 0.f; // -0 and +0 are the same value
+	uint32_t bits;
+	std::memcpy(&bits, &f, sizeof bits);
+	return mix(bits);
+}
+
+template<size_t N>
+uint64_t hash(StaticString<N> const &s) {
+	return hash_bytes(s.c_str());
+}
+
+inline uint64_t hash(Jack const &jack) {
+	return mix((uint64_t(jack.module_id) << 16) | jack.jack_id);
+}
+
+inline uint64_t hash(std::vector<Jack> const &jacks) {
+	uint64_t h = 0;
+	for (auto const &j : jacks)
+		h += hash(j);
+	return h;
+}
+
+inline uint64_t hash(InternalCable const &cable) {
+	auto h = combine(hash(cable.out), hash(cable.ins));
+	return combine(h, cable.color.has_value() ? (0x10000ULL | *cable.color) : 0);
+}
+
+inline uint64_t hash(MappedInputJack const &map) {
+	return combine(combine(mix(map.panel_jack_id), hash(map.ins)), hash(map.alias_name));
+}
+
+inline uint64_t hash(MappedOutputJack const &map) {
+	return combine(combine(mix(map.panel_jack_id), hash(map.out)), hash(map.alias_name));
+}
+
+inline uint64_t hash(StaticParam const &knob) {
+	return combine(mix((uint64_t(knob.module_id) << 16) | knob.param_id), hash(knob.value));
+}
+
+inline uint64_t hash(MappedKnob const &map) {
+	uint64_t ids = (uint64_t(map.panel_knob_id) << 32) | (uint64_t(map.module_id) << 16) | map.param_id;
+	uint64_t flags = (uint64_t(map.curve_type) << 8) | map.midi_chan;
+	auto h = combine(mix(ids), flags);
+	h = combine(h, hash(map.min));
+	h = combine(h, hash(map.max));
+	return combine(h, hash(map.alias_name));
+}
+
+inline uint64_t hash(MappedLight const &map) {
+	return mix((uint64_t(map.panel_light_id) << 32) | (uint64_t(map.module_id) << 16) | map.light_id);
+}
+
+inline uint64_t hash(ModuleInitState const &state) {
+	return combine(mix(state.module_id), hash_bytes(state.data()));
+}
+
+inline uint64_t hash(ModuleAlias const &alias) {
+	return combine(mix(alias.module_id), hash(alias.alias_name));
+}
+
+inline uint64_t hash_bypassed(uint16_t module_id) {
+	return mix(0xB7'0000ULL | module_id);
+}
+
+inline uint64_t hash_metadata(PatchData const &pd) {
+	auto h = combine(hash(pd.patch_name), hash(pd.description));
+	h = combine(h, pd.midi_poly_num);
+	h = combine(h, pd.midi_poly_num_setting);
+	h = combine(h, static_cast<uint64_t>(pd.midi_poly_mode));
+	h = combine(h, hash(pd.midi_pitchwheel_range));
+	h = combine(h, pd.suggested_samplerate);
+	return combine(h, pd.suggested_blocksize);
+}
+
+inline uint64_t hash_slugs(PatchData const &pd) {
+	uint64_t h = pd.module_slugs.size();
+	for (auto const &slug : pd.module_slugs)
+		h = combine(h, hash(slug));
+	return h;
+}
+
+} // namespace PatchHash
+
+struct PatchHasher {
+	uint64_t metadata = 0;
+	uint64_t module_slugs = 0;
+	uint64_t int_cables = 0;
+	uint64_t mapped_ins = 0;
+	uint64_t mapped_outs = 0;
+	uint64_t static_knobs = 0;
+	uint64_t mapped_lights = 0;
+	uint64_t module_states = 0;
+	uint64_t bypassed_modules = 0;
+	uint64_t module_aliases = 0;
+	uint64_t midi_maps = 0;
+	uint64_t midi_maps_name = 0;
+	std::vector<uint64_t> knob_sets;	   // one sum per knob set
+	std::vector<uint64_t> knob_set_names; // one per knob set of the patch
+
+	PatchHasher() = default;
+
+	explicit PatchHasher(PatchData const &pd) {
+		reset(pd);
+	}
+
+	// Hashes the entire patch
+	void reset(PatchData const &pd) {
+		*this = PatchHasher{};
+
+		update_metadata(pd);
+		update_module_slugs(pd);
+
+		for (auto const &x : pd.int_cables)
+			add(x);
+		for (auto const &x : pd.mapped_ins)
+			add(x);
+		for (auto const &x : pd.mapped_outs)
+			add(x);
+		for (auto const &x : pd.static_knobs)
+			add(x);
+		for (auto const &x : pd.mapped_lights)
+			add(x);
+		for (auto const &x : pd.module_states)
+			add(x);
+		for (auto const &x : pd.module_aliases)
+			add(x);
+		for (auto x : pd.bypassed_modules)
+			add_bypassed(x);
+
+		for (auto const &m : pd.midi_maps.set)
+			add_mapping(PatchData::MIDIKnobSet, m);
+
+		update_knob_set_names(pd);
+		for (unsigned set_id = 0; set_id < pd.knob_sets.size(); set_id++) {
+			for (auto const &m : pd.knob_sets[set_id].set)
+				add_mapping(set_id, m);
+		}
+	}
+
+	// Call after changing the patch name, description, or any other scalar field
+	void update_metadata(PatchData const &pd) {
+		metadata = PatchHash::hash_metadata(pd);
+	}
+
+	// Call after adding or removing modules
+	void update_module_slugs(PatchData const &pd) {
+		module_slugs = PatchHash::hash_slugs(pd);
+	}
+
+	// Call after adding, removing or renaming knob sets
+	void update_knob_set_names(PatchData const &pd) {
+		knob_set_names.resize(pd.knob_sets.size());
+		for (unsigned i = 0; i < knob_set_names.size(); i++)
+			knob_set_names[i] = PatchHash::hash(pd.knob_sets[i].name);
+		if (knob_sets.size() < knob_set_names.size())
+			knob_sets.resize(knob_set_names.size());
+		midi_maps_name = PatchHash::hash(pd.midi_maps.name);
+	}
+
+	void add(InternalCable const &x) {
+		int_cables += PatchHash::hash(x);
+	}
+	void remove(InternalCable const &x) {
+		int_cables -= PatchHash::hash(x);
+	}
+
+	void add(MappedInputJack const &x) {
+		mapped_ins += PatchHash::hash(x);
+	}
+	void remove(MappedInputJack const &x) {
+		mapped_ins -= PatchHash::hash(x);
+	}
+
+	void add(MappedOutputJack const &x) {
+		mapped_outs += PatchHash::hash(x);
+	}
+	void remove(MappedOutputJack const &x) {
+		mapped_outs -= PatchHash::hash(x);
+	}
+
+	void add(StaticParam const &x) {
+		static_knobs += PatchHash::hash(x);
+	}
+	void remove(StaticParam const &x) {
+		static_knobs -= PatchHash::hash(x);
+	}
+
+	void add(MappedLight const &x) {
+		mapped_lights += PatchHash::hash(x);
+	}
+	void remove(MappedLight const &x) {
+		mapped_lights -= PatchHash::hash(x);
+	}
+
+	void add(ModuleInitState const &x) {
+		module_states += PatchHash::hash(x);
+	}
+	void remove(ModuleInitState const &x) {
+		module_states -= PatchHash::hash(x);
+	}
+
+	void add(ModuleAlias const &x) {
+		module_aliases += PatchHash::hash(x);
+	}
+	void remove(ModuleAlias const &x) {
+		module_aliases -= PatchHash::hash(x);
+	}
+
+	void add_bypassed(uint16_t module_id) {
+		bypassed_modules += PatchHash::hash_bypassed(module_id);
+	}
+	void remove_bypassed(uint16_t module_id) {
+		bypassed_modules -= PatchHash::hash_bypassed(module_id);
+	}
+
+	// set_id may be PatchData::MIDIKnobSet
+	void add_mapping(uint32_t set_id, MappedKnob const &map) {
+		if (auto *set = set_sum(set_id))
+			*set += PatchHash::hash(map);
+	}
+	void remove_mapping(uint32_t set_id, MappedKnob const &map) {
+		if (auto *set = set_sum(set_id))
+			*set -= PatchHash::hash(map);
+	}
+
+	uint64_t value() const {
+		auto h = PatchHash::combine(metadata, module_slugs);
+		h = PatchHash::combine(h, int_cables);
+		h = PatchHash::combine(h, mapped_ins);
+		h = PatchHash::combine(h, mapped_outs);
+		h = PatchHash::combine(h, static_knobs);
+		h = PatchHash::combine(h, mapped_lights);
+		h = PatchHash::combine(h, module_states);
+		h = PatchHash::combine(h, bypassed_modules);
+		h = PatchHash::combine(h, module_aliases);
+		h = PatchHash::combine(h, PatchHash::combine(midi_maps_name, midi_maps));
+		h = PatchHash::combine(h, knob_set_names.size());
+		for (unsigned i = 0; i < knob_set_names.size(); i++) {
+			auto sum = i < knob_sets.size() ? knob_sets[i] : 0;
+			h = PatchHash::combine(h, PatchHash::combine(knob_set_names[i], sum));
+		}
+		return h;
+	}
+
+private:
+	uint64_t *set_sum(uint32_t set_id) {
+		if (set_id == PatchData::MIDIKnobSet)
+			return &midi_maps;
+		if (set_id >= knob_sets.size())
+			knob_sets.resize(set_id + 1);
+		return &knob_sets[set_id];
+	}
+};
+
+inline uint64_t patch_hash(PatchData const &pd) {
+	return PatchHasher{pd}.value();
+}
+
+} // namespace MetaModule
@@ -0,0 +1,292 @@
+#include "patch_bank.hh"
+#include "lz.hh"
+#include "patch/patch_hash.hh"
+#include "yaml_to_patch.hh"
+#include <algorithm>
+#include <numeric>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MetaModule
+{
+
+namespace
+{
+
+constexpr uint8_t Magic[4] = {'M', 'M', 'P', 'B'};
+constexpr uint16_t Version = 1;
+constexpr size_t HeaderSize = 16;
+constexpr size_t EntrySize = 32;
+constexpr size_t DataAlign = 8;
+
+void put16(uint8_t *p, uint16_t v) {
+	p[0] = uint8_t(v);
+	p[1] = uint8_t(v >> 8);
+}
+
+void put32(uint8_t *p, uint32_t v) {
+	for (unsigned i = 0; i < 4; i++)
+		p[i] = uint8_t(v >> (8 * i));
+}
+
+void put64(uint8_t *p, uint64_t v) {
+	for (unsigned i = 0; i < 8; i++)
+		p[i] = uint8_t(v >> (8 * i));
+}
+
+uint16_t get16(const uint8_t *p) {
+	return uint16_t(p[0] | (p[1] << 8));
+}
+
+uint32_t get32(const uint8_t *p) {
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+uint64_t get64(const uint8_t *p) {
+	return uint64_t(get32(p)) | (uint64_t(get32(p + 4)) << 32);
+}
+
+uint64_t hash_data(std::span<const uint8_t> data) {
+	return PatchHash::hash_bytes({reinterpret_cast<const char *>(data.data()), data.size()});
+}
+
+struct RawEntry {
+	uint32_t name_offset;
+	uint32_t name_size;
+	uint32_t data_offset;
+	uint32_t data_size;
+	uint64_t hash;
+	uint8_t format;
+
+	static RawEntry read(const uint8_t *p) {
+		return {get32(p), get32(p + 4), get32(p + 8), get32(p + 12), get64(p + 16), p[24]};
+	}
+};
+
+} // namespace
+
+bool PatchBankWriter::add(std::string_view name, std::span<const uint8_t> data, PatchBankFormat format) {
+	if (std::any_of(patches.begin(), patches.end(), [=](auto const &p) { return p.name == name; }))
+		return false;
+
+	patches.push_back({std::string{name}, {data.begin(), data.end()}, format});
+	return true;
+}
+
+bool PatchBankWriter::add(std::string_view name, std::string_view yaml) {
+	return add(name, {reinterpret_cast<const uint8_t *>(yaml.data()), yaml.size()}, PatchBankFormat::Yaml);
+}
+
+std::vector<uint8_t> PatchBankWriter::build() const {
+	std::vector<size_t> order(patches.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return patches[a].name < patches[b].name; });
+
+	size_t names_size = 0;
+	for (auto const &p : patches)
+		names_size += p.name.size();
+
+	size_t data_start = HeaderSize + EntrySize * patches.size() + names_size;
+	size_t total = data_start;
+	for (auto const &p : patches)
+		total = (total + DataAlign - 1) / DataAlign * DataAlign + p.data.size();
+
+	if (total > UINT32_MAX)
+		return {};
+
+	std::vector<uint8_t> bank(total);
+
+	std::copy(std::begin(Magic), std::end(Magic), bank.begin());
+	put16(&bank[4], Version);
+	put32(&bank[8], uint32_t(patches.size()));
+	put32(&bank[12], uint32_t(total));
+
+	size_t name_pos = HeaderSize + EntrySize * patches.size();
+	size_t data_pos = data_start;
+
+	for (size_t i = 0; auto idx : order) {
+		auto const &p = patches[idx];
+		data_pos = (data_pos + DataAlign - 1) / DataAlign * DataAlign;
+
+		uint8_t *e = &bank[HeaderSize + EntrySize * i];
+		put32(e, uint32_t(name_pos));
+		put32(e + 4, uint32_t(p.name.size()));
+		put32(e + 8, uint32_t(data_pos));
+		put32(e + 12, uint32_t(p.data.size()));
+		put64(e + 16, hash_data(p.data));
+		e[24] = static_cast<uint8_t>(p.format);
+
+		std::copy(p.name.begin(), p.name.end(), bank.begin() + name_pos);
+		std::copy(p.data.begin(), p.data.end(), bank.begin() + data_pos);
+		name_pos += p.name.size();
+		data_pos += p.data.size();
+		i++;
+	}
+
+	return bank;
+}
+
+bool PatchBankReader::open(std::span<const uint8_t> new_bank) {
+	bank = {};
+	num_entries = 0;
+
+	if (new_bank.size() < HeaderSize || !std::equal(std::begin(Magic), std::end(Magic), new_bank.begin()))
+		return false;
+
+	if (get16(&new_bank[4]) != Version || get32(&new_bank[12]) > new_bank.size())
+		return false;
+
+	auto count = get32(&new_bank[8]);
+	if (count > (new_bank.size() - HeaderSize) / EntrySize)
+		return false;
+
+	// Check every entry now, so entry() and find() can trust the index
+	std::string_view prev_name;
+	for (uint32_t i = 0; i < count; i++) {
+		auto e = RawEntry::read(&new_bank[HeaderSize + EntrySize * i]);
+
+		if (e.name_offset > new_bank.size() || e.name_size > new_bank.size() - e.name_offset)
+			return false;
+		if (e.data_offset > new_bank.size() || e.data_size > new_bank.size() - e.data_offset)
+			return false;
+		if (e.format > static_cast<uint8_t>(PatchBankFormat::Binary))
+			return false;
+
+		std::string_view name{reinterpret_cast<const char *>(&new_bank[e.name_offset]), e.name_size};
+		if (i > 0 && !(prev_name < name))
+			return false;
+		prev_name = name;
+	}
+
+	bank = new_bank;
+	num_entries = count;
+	return true;
+}
+
+PatchBankEntry PatchBankReader::entry(size_t idx) const {
+	if (idx >= num_entries)
+		return {};
+
+	auto e = RawEntry::read(&bank[HeaderSize + EntrySize * idx]);
+	return {
+		.name = {reinterpret_cast<const char *>(&bank[e.name_offset]), e.name_size},
+		.format = static_cast<PatchBankFormat>(e.format),
+		.data = bank.subspan(e.data_offset, e.data_size),
+		.hash = e.hash,
+	};
+}
+
+std::optional<size_t> PatchBankReader::find(std::string_view name) const {
+	size_t lo = 0;
+	size_t hi = num_entries;
+	while (lo < hi) {
+		auto mid = lo + (hi - lo) / 2;
+		auto mid_name = entry(mid).name;
+		if (mid_name == name)
+			return mid;
+		if (mid_name < name)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return std::nullopt;
+}
+
+bool PatchBankReader::verify(size_t idx) const {
+	if (idx >= num_entries)
+		return false;
+	auto e = entry(idx);
+	return hash_data(e.data) == e.hash;
+}
+
+bool PatchBankReader::load(size_t idx,
+						   PatchData &pd,
+						   std::vector<char> &scratch,
+						   std::span<const uint8_t> dict) const {
+	return load(idx, pd, scratch, PatchLoadOptions{}, dict);
+}
+
+bool PatchBankReader::load(size_t idx,
+						   PatchData &pd,
+						   std::vector<char> &scratch,
+						   PatchLoadOptions const &options,
+						   std::span<const uint8_t> dict) const {
+	if (idx >= num_entries)
+		return false;
+
+	auto e = entry(idx);
+
+	if (e.format == PatchBankFormat::Yaml) {
+		if (e.data.size() > options.limits.max_file_bytes)
+			return false;
+		scratch.assign(e.data.begin(), e.data.end());
+
+	} else if (e.format == PatchBankFormat::LzYaml) {
+		// decompressed_size() rejects sizes the compressed data can't produce
+		auto size = Lz::decompressed_size(e.data);
+		if (!size || *size > options.limits.max_file_bytes)
+			return false;
+		scratch.resize(*size);
+		std::span<uint8_t> dst{reinterpret_cast<uint8_t *>(scratch.data()), scratch.size()};
+		if (!Lz::decompress_into(e.data, dst, dict))
+			return false;
+
+	} else {
+		return false;
+	}
+
+	return yaml_raw_to_patch(scratch, pd, options);
+}
+
+#if __has_include(<sys/mman.h>)
+
+MappedPatchBank::~MappedPatchBank() {
+	close();
+}
+
+bool MappedPatchBank::open(const char *path) {
+	close();
+
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st {};
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+
+	length = size_t(st.st_size);
+	addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (addr == MAP_FAILED) {
+		addr = nullptr;
+		length = 0;
+		return false;
+	}
+
+	if (!reader_.open({static_cast<const uint8_t *>(addr), length})) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedPatchBank::close() {
+	if (addr)
+		munmap(addr, length);
+	addr = nullptr;
+	length = 0;
+	reader_ = {};
+}
+
+#endif
+
+} // namespace MetaModule
@@ -0,0 +1,123 @@
+#pragma once
+#include "patch/patch_data.hh"
+#include "yaml_to_patch.hh"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace MetaModule
+{
+
+// A patch bank packs many patch files into one, with an index for random access.
+//
+// Layout (all integers little-endian):
+//   Header        "MMPB", version (u16), reserved (u16), num_entries (u32), total size (u32)
+//   Index         num_entries x Entry, sorted by name
+//   Names         the entries' names, not terminated
+//   Data          each patch, 8-byte aligned
+//
+// Entry: name offset (u32), name size (u32), data offset (u32), data size (u32),
+//        hash of the data (u64), format (u8), 7 bytes reserved
+//
+// Offsets are from the start of the bank.
+
+enum class PatchBankFormat : uint8_t {
+	Yaml = 0,
+	LzYaml = 1, // yaml in an Lz frame
+	Binary = 2, // opaque to the bank
+};
+
+struct PatchBankEntry {
+	std::string_view name;
+	PatchBankFormat format;
+	std::span<const uint8_t> data;
+	uint64_t hash;
+};
+
+class PatchBankWriter {
+public:
+	// Returns false if the name is already used
+	bool add(std::string_view name, std::span<const uint8_t> data, PatchBankFormat format = PatchBankFormat::Yaml);
+	bool add(std::string_view name, std::string_view yaml);
+
+	size_t size() const {
+		return patches.size();
+	}
+
+	// Returns an empty vector if the bank would be larger than 4 GiB
+	std::vector<uint8_t> build() const;
+
+private:
+	struct Patch {
+		std::string name;
+		std::vector<uint8_t> data;
+		PatchBankFormat format;
+	};
+	std::vector<Patch> patches;
+};
+
+// Reads a bank in place, from a memory-mapped file or a buffer. Nothing is copied or
+// allocated, and lookups are a binary search of the index. The bank memory must
+// outlive the reader and the entries it returns.
+class PatchBankReader {
+public:
+	PatchBankReader() = default;
+
+	// Validates the header and index. Returns false if the bank is malformed.
+	bool open(std::span<const uint8_t> bank);
+
+	size_t size() const {
+		return num_entries;
+	}
+
+	PatchBankEntry entry(size_t idx) const;
+	std::optional<size_t> find(std::string_view name) const;
+
+	// Checks the data against its stored hash
+	bool verify(size_t idx) const;
+
+	// Parses a Yaml or LzYaml entry. The yaml is copied into scratch first, since the
+	// parser works in place and the bank may be read-only.
+	bool load(size_t idx, PatchData &pd, std::vector<char> &scratch, std::span<const uint8_t> dict = {}) const;
+
+	// As above, with options passed to the parser. An entry whose yaml would be larger
+	// than options.limits.max_file_bytes is rejected before scratch is resized. With
+	// retain_source, scratch must outlive pd.
+	bool load(size_t idx,
+			  PatchData &pd,
+			  std::vector<char> &scratch,
+			  PatchLoadOptions const &options,
+			  std::span<const uint8_t> dict = {}) const;
+
+private:
+	std::span<const uint8_t> bank;
+	uint32_t num_entries = 0;
+};
+
+#if __has_include(<sys/mman.h>)
+// Maps a bank file read-only (host builds only)
+class MappedPatchBank {
+public:
+	MappedPatchBank() = default;
+	MappedPatchBank(MappedPatchBank const &) = delete;
+	MappedPatchBank &operator=(MappedPatchBank const &) = delete;
+	~MappedPatchBank();
+
+	bool open(const char *path);
+	void close();
+
+	PatchBankReader const &reader() const {
+		return reader_;
+	}
+
+private:
+	void *addr = nullptr;
+	size_t length = 0;
+	PatchBankReader reader_;
+};
+#endif
+
+} // namespace MetaModule
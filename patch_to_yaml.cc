@@ -1,64 +1,281 @@
 #include "patch_to_yaml.hh"
+#include "patch_trace.hh"
 #include "ryml/ryml_init.hh"
 #include "ryml/ryml_serial.hh"
+#include <algorithm>
 #include <span>
 
 namespace MetaModule
 {
 
-static ryml::Tree create_tree(PatchData const &pd, ryml::Tree &tree) {
+namespace
+{
+
+// The top-level keys, in the order they're written
+enum Field : unsigned {
+	PatchName,
+	Description,
+	ModuleSlugs,
+	IntCables,
+	MappedIns,
+	MappedOuts,
+	StaticKnobs,
+	MappedKnobs,
+	MidiMaps,
+	MidiPolyNum,
+	MidiPolyNumSetting,
+	MidiPolyMode,
+	MidiPitchwheelRange,
+	MappedLights,
+	ModuleStates,
+	SuggestedSamplerate,
+	SuggestedBlocksize,
+	BypassedModules,
+	ModuleAliases,
+	NumFields
+};
+
+void write_value(ryml::NodeRef &data, const char *key, auto const &val, bool compact) {
+	if constexpr (requires(ryml::NodeRef n) { write_compact(&n, val); }) {
+		if (compact) {
+			auto node = data.append_child();
+			node << ryml::key(ryml::to_csubstr(key));
+			write_compact(&node, val);
+			return;
+		}
+	}
+	data[ryml::to_csubstr(key)] << val;
+}
+
+// Writes items [first, last) of a list section, as they'd appear in the whole list
+template<typename T>
+void write_items(
+	ryml::NodeRef &data, const char *key, std::vector<T> const &v, size_t first, size_t last, bool compact) {
+	auto node = data.append_child();
+	node << ryml::key(ryml::to_csubstr(key));
+	node |= ryml::SEQ;
+
+	for (auto i = first; i < last; i++) {
+		auto child = node.append_child();
+		if constexpr (requires(ryml::NodeRef n, T const &x) { write_compact(&n, x); }) {
+			if (compact) {
+				write_compact(&child, v[i]);
+				continue;
+			}
+		}
+		child << v[i];
+	}
+}
+
+// Module slugs are a map keyed by index
+void write_items(
+	ryml::NodeRef &data, const char *key, std::vector<BrandModuleSlug> const &v, size_t first, size_t last, bool) {
+	auto node = data.append_child();
+	node << ryml::key(ryml::to_csubstr(key));
+	write_slugs(&node, std::span{v}.subspan(first, last - first), first);
+}
+
+// Calls list(key, vector) for list fields, or value(key, value) for the rest
+auto visit_field(PatchData const &pd, Field field, auto &&list, auto &&value) {
+	switch (field) {
+		case PatchName:
+			return value("patch_name", pd.patch_name);
+		case Description:
+			return value("description", pd.description);
+		case ModuleSlugs:
+			return list("module_slugs", pd.module_slugs);
+		case IntCables:
+			return list("int_cables", pd.int_cables);
+		case MappedIns:
+			return list("mapped_ins", pd.mapped_ins);
+		case MappedOuts:
+			return list("mapped_outs", pd.mapped_outs);
+		case StaticKnobs:
+			return list("static_knobs", pd.static_knobs);
+		case MappedKnobs:
+			return list("mapped_knobs", pd.knob_sets);
+		case MidiMaps:
+			return value("midi_maps", pd.midi_maps);
+		case MidiPolyNum:
+			return value("midi_poly_num", pd.midi_poly_num);
+		case MidiPolyNumSetting:
+			return value("midi_poly_num_setting", pd.midi_poly_num_setting);
+		case MidiPolyMode:
+			return value("midi_poly_mode", static_cast<unsigned>(pd.midi_poly_mode));
+		case MidiPitchwheelRange:
+			return value("midi_pitchwheel_range", ShortFloat{pd.midi_pitchwheel_range});
+		case MappedLights:
+			return list("mapped_lights", pd.mapped_lights);
+		case ModuleStates:
+			return list("vcvModuleStates", pd.module_states);
+		case SuggestedSamplerate:
+			return value("suggested_samplerate", pd.suggested_samplerate);
+		case SuggestedBlocksize:
+			return value("suggested_blocksize", pd.suggested_blocksize);
+		case BypassedModules:
+			return list("bypassed_modules", pd.bypassed_modules);
+		case ModuleAliases:
+		default:
+			return list("module_aliases", pd.module_aliases);
+	}
+}
+
+// An empty list is still one entry, written as `key: []`
+size_t num_entries(PatchData const &pd, Field field) {
+	return visit_field(
+		pd,
+		field,
+		[](const char *, auto const &v) { return std::max<size_t>(v.size(), 1); },
+		[](const char *, auto const &) { return size_t{1}; });
+}
+
+void write_entries(ryml::NodeRef &data, PatchData const &pd, Field field, size_t first, size_t last, bool compact) {
+	visit_field(
+		pd,
+		field,
+		[&](const char *key, auto const &v) { write_items(data, key, v, first, std::min(last, v.size()), compact); },
+		[&](const char *key, auto const &val) { write_value(data, key, val, compact); });
+}
+
+// Writes a whole field. List sections are traced, with bytes as the arena space used
+// by the section's scalars.
+void write_field(ryml::NodeRef &data, PatchData const &pd, Field field, bool compact) {
+	visit_field(
+		pd,
+		field,
+		[&](const char *key, auto const &v) {
+			PATCH_TRACE_BEGIN(trace, "save", key);
+			[[maybe_unused]] auto arena_start = data.tree()->arena_pos();
+			write_items(data, key, v, 0, v.size(), compact);
+			PATCH_TRACE_END(trace, data.tree()->arena_pos() - arena_start, v.size());
+		},
+		[&](const char *key, auto const &val) { write_value(data, key, val, compact); });
+}
+
+} // namespace
+
+static void create_tree(PatchData const &pd, ryml::Tree &tree, PatchWriteOptions const &options) {
+	PATCH_TRACE_BEGIN(trace, "save", "create_tree");
+
 	ryml::NodeRef root = tree.rootref();
 	root |= ryml::MAP;
 
 	ryml::NodeRef data = root["PatchData"];
 	data |= ryml::MAP;
 
-	data["patch_name"] << pd.patch_name;
-	data["description"] << pd.description;
-	data["module_slugs"] << pd.module_slugs;
-	data["int_cables"] << pd.int_cables;
-	data["mapped_ins"] << pd.mapped_ins;
-	data["mapped_outs"] << pd.mapped_outs;
-	data["static_knobs"] << pd.static_knobs;
-	data["mapped_knobs"] << pd.knob_sets;
-	data["midi_maps"] << pd.midi_maps;
-	data["midi_poly_num"] << pd.midi_poly_num;
-	data["midi_poly_num_setting"] << pd.midi_poly_num_setting;
-	data["midi_poly_mode"] << static_cast<unsigned>(pd.midi_poly_mode);
-	data["midi_pitchwheel_range"] << pd.midi_pitchwheel_range;
-	data["mapped_lights"] << pd.mapped_lights;
-	data["vcvModuleStates"] << pd.module_states;
-	data["suggested_samplerate"] << pd.suggested_samplerate;
-	data["suggested_blocksize"] << pd.suggested_blocksize;
-	data["bypassed_modules"] << pd.bypassed_modules;
-	data["module_aliases"] << pd.module_aliases;
-
-	return tree;
+	for (unsigned field = 0; field < NumFields; field++)
+		write_field(data, pd, Field(field), options.compact);
+
+	PATCH_TRACE_END(trace, tree.arena_pos(), tree.size());
 }
 
 std::string patch_to_yaml_string(PatchData const &pd) {
+	return patch_to_yaml_string(pd, {});
+}
+
+std::string patch_to_yaml_string(PatchData const &pd, PatchWriteOptions const &options) {
 	RymlInit::init_once();
 
+	PATCH_TRACE_BEGIN(total, "save", "patch_to_yaml_string");
+
 	ryml::Tree tree;
-	create_tree(pd, tree);
+	create_tree(pd, tree, options);
 
-	return ryml::emitrs_yaml<std::string>(tree);
+	PATCH_TRACE_BEGIN(emit, "save", "emit");
+	auto yaml = ryml::emitrs_yaml<std::string>(tree);
+	PATCH_TRACE_END(emit, yaml.size(), tree.size());
+
+	PATCH_TRACE_END(total, yaml.size(), pd.module_slugs.size());
+	return yaml;
 }
 
 size_t patch_to_yaml_buffer(PatchData const &pd, std::span<char> &buffer) {
+	return patch_to_yaml_buffer(pd, buffer, {});
+}
+
+size_t patch_to_yaml_buffer(PatchData const &pd, std::span<char> &buffer, PatchWriteOptions const &options) {
 	RymlInit::init_once();
 
+	PATCH_TRACE_BEGIN(total, "save", "patch_to_yaml_buffer");
+
 	ryml::Tree tree;
-	create_tree(pd, tree);
+	create_tree(pd, tree, options);
 
+	PATCH_TRACE_BEGIN(emit, "save", "emit");
 	ryml::substr s{buffer.data(), buffer.size()};
 	bool emit_error_on_overflow = true;
 	auto res = ryml::emit_yaml(tree, s, emit_error_on_overflow);
+	PATCH_TRACE_END(emit, res.size(), tree.size());
+	PATCH_TRACE_END(total, res.size(), pd.module_slugs.size());
 	//resize
 	buffer = buffer.subspan(0, res.size());
 	return res.size();
 }
 
+// emit_json leaves scalars that read as numbers, true, false or null unquoted, so a
+// patch named "123" would be a number to other JSON readers. Marks the scalars of
+// string fields as quoted.
+static void quote_json_strings(ryml::NodeRef node) {
+	auto in_slugs = node.has_key() && node.key() == "module_slugs";
+
+	for (auto child : node.children()) {
+		if (!child.has_val()) {
+			quote_json_strings(child);
+			continue;
+		}
+
+		auto key = child.has_key() ? child.key() : ryml::csubstr{};
+		if (in_slugs || key == "patch_name" || key == "description" || key == "alias_name" || key == "name" ||
+			key == "data")
+			child |= ryml::VALQUO;
+	}
+}
+
+std::string patch_to_json_string(PatchData const &pd) {
+	return patch_to_json_string(pd, {});
+}
+
+std::string patch_to_json_string(PatchData const &pd, PatchWriteOptions const &options) {
+	RymlInit::init_once();
+
+	PATCH_TRACE_BEGIN(total, "save", "patch_to_json_string");
+
+	ryml::Tree tree;
+	create_tree(pd, tree, options);
+	quote_json_strings(tree.rootref());
+
+	PATCH_TRACE_BEGIN(emit, "save", "emit_json");
+	auto json = ryml::emitrs_json<std::string>(tree);
+	PATCH_TRACE_END(emit, json.size(), tree.size());
+
+	PATCH_TRACE_END(total, json.size(), pd.module_slugs.size());
+	return json;
+}
+
+size_t patch_to_json_buffer(PatchData const &pd, std::span<char> &buffer) {
+	return patch_to_json_buffer(pd, buffer, {});
+}
+
+size_t patch_to_json_buffer(PatchData const &pd, std::span<char> &buffer, PatchWriteOptions const &options) {
+	RymlInit::init_once();
+
+	PATCH_TRACE_BEGIN(total, "save", "patch_to_json_buffer");
+
+	ryml::Tree tree;
+	create_tree(pd, tree, options);
+	quote_json_strings(tree.rootref());
+
+	PATCH_TRACE_BEGIN(emit, "save", "emit_json");
+	ryml::substr s{buffer.data(), buffer.size()};
+	bool emit_error_on_overflow = true;
+	auto res = ryml::emit_json(tree, s, emit_error_on_overflow);
+	PATCH_TRACE_END(emit, res.size(), tree.size());
+	PATCH_TRACE_END(total, res.size(), pd.module_slugs.size());
+
+	buffer = buffer.subspan(0, res.size());
+	return res.size();
+}
+
 std::string json_to_yml(std::string json) {
 	if (json.back() == '\0')
 		json.pop_back();
@@ -68,4 +285,120 @@ std::string json_to_yml(std::string json) {
 	return ryml::emitrs_yaml<std::string>(tree);
 }
 
+// Resumable emitting
+
+struct ResumablePatchEmitter::State {
+	PatchData pd;
+	Sink sink;
+	PatchWriteOptions options;
+	size_t chunk_bytes;
+
+	Status status = Status::InProgress;
+	size_t bytes_written = 0;
+
+	Field field = PatchName;
+	size_t item = 0;
+
+	// Entries per piece, adjusted to the size of the last piece
+	size_t entries_per_piece = 16;
+
+	ryml::Tree tree;
+	std::string text;
+
+	void write_piece() {
+		tree.clear();
+		tree.clear_arena();
+
+		ryml::NodeRef root = tree.rootref();
+		root |= ryml::MAP;
+		ryml::NodeRef data = root["PatchData"];
+		data |= ryml::MAP;
+
+		bool first_piece = field == PatchName && item == 0;
+		bool continues_section = item > 0;
+
+		size_t num_written = 0;
+		while (field < NumFields && num_written < entries_per_piece) {
+			auto n = num_entries(pd, field);
+			auto last = std::min(n, item + (entries_per_piece - num_written));
+			write_entries(data, pd, field, item, last, options.compact);
+			num_written += last - item;
+
+			if (last == n) {
+				field = Field(field + 1);
+				item = 0;
+			} else {
+				item = last;
+			}
+		}
+
+		ryml::emitrs_yaml(tree, &text);
+
+		// Drop the lines already written: `PatchData:` and the key of a section that
+		// was split
+		std::string_view piece = text;
+		if (!first_piece)
+			piece.remove_prefix(std::min(piece.find('\n') + 1, piece.size()));
+		if (continues_section)
+			piece.remove_prefix(std::min(piece.find('\n') + 1, piece.size()));
+
+		if (!sink(piece)) {
+			status = Status::Failed;
+			return;
+		}
+		bytes_written += piece.size();
+
+		auto bytes_per_entry = std::max<size_t>(piece.size() / std::max<size_t>(num_written, 1), 1);
+		entries_per_piece = std::clamp<size_t>(chunk_bytes / bytes_per_entry, 1, 4096);
+
+		if (field == NumFields)
+			status = Status::Done;
+	}
+};
+
+ResumablePatchEmitter::ResumablePatchEmitter(PatchData const &pd,
+											 Sink sink,
+											 PatchWriteOptions const &options,
+											 size_t chunk_bytes)
+	: ResumablePatchEmitter{PatchData{pd}, std::move(sink), options, chunk_bytes} {
+}
+
+ResumablePatchEmitter::ResumablePatchEmitter(PatchData &&pd,
+											 Sink sink,
+											 PatchWriteOptions const &options,
+											 size_t chunk_bytes)
+	: state{new State{std::move(pd), std::move(sink), options, chunk_bytes}} {
+	RymlInit::init_once();
+
+	// The snapshot mustn't depend on the yaml buffer of a patch loaded with retain_source
+	for (auto &module_state : state->pd.module_states)
+		module_state.mutable_data();
+}
+
+ResumablePatchEmitter::~ResumablePatchEmitter() = default;
+
+ResumablePatchEmitter::Status ResumablePatchEmitter::step(size_t max_bytes) {
+	auto &s = *state;
+	if (s.status != Status::InProgress)
+		return s.status;
+
+	PATCH_TRACE_BEGIN(trace, "save", "step");
+	auto start = s.bytes_written;
+
+	do {
+		s.write_piece();
+	} while (s.status == Status::InProgress && s.bytes_written - start < max_bytes);
+
+	PATCH_TRACE_END(trace, s.bytes_written - start, 1);
+	return s.status;
+}
+
+ResumablePatchEmitter::Status ResumablePatchEmitter::status() const {
+	return state->status;
+}
+
+size_t ResumablePatchEmitter::bytes_written() const {
+	return state->bytes_written;
+}
+
 } // namespace MetaModule
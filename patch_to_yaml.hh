@@ -1,16 +1,82 @@
 #pragma once
 #include "patch/patch.hh"
 #include "patch/patch_data.hh"
+#include <functional>
+#include <memory>
 #include <span>
+#include <string_view>
 
 namespace MetaModule
 {
 
+struct PatchWriteOptions {
+	// Write jacks, cables, static knobs, mappings and lights in flow style, e.g. `out: [1, 2]`.
+	// Files are several times smaller and faster to parse, but need a reader that
+	// accepts the compact forms (any version of yaml_raw_to_patch that has this option).
+	bool compact = false;
+};
+
 std::string patch_to_yaml_string(PatchData const &pd);
+std::string patch_to_yaml_string(PatchData const &pd, PatchWriteOptions const &options);
 
 // Writes yaml to the given span
 size_t patch_to_yaml_buffer(PatchData const &pd, std::span<char> &buffer);
+size_t patch_to_yaml_buffer(PatchData const &pd, std::span<char> &buffer, PatchWriteOptions const &options);
+
+// JSON with the same structure and fields as the yaml. With options.compact, jacks,
+// static knobs and lights are written as arrays.
+std::string patch_to_json_string(PatchData const &pd);
+std::string patch_to_json_string(PatchData const &pd, PatchWriteOptions const &options);
+
+// Writes JSON to the given span
+size_t patch_to_json_buffer(PatchData const &pd, std::span<char> &buffer);
+size_t patch_to_json_buffer(PatchData const &pd, std::span<char> &buffer, PatchWriteOptions const &options);
 
+// Parses the whole document into a tree. For large files, json_to_yml_stream()
+// converts with a small fixed working set.
 std::string json_to_yml(std::string json);
 
+// Writes a patch in slices, e.g. for autosaving in idle time without stalling the UI.
+//
+// The emitter works from a copy of the patch taken when it's constructed, so edits made
+// between steps don't affect the output. Each step builds and emits a small tree for the
+// next few sections, or the next items of a long section, and passes the text to the
+// sink. Together the pieces are identical to patch_to_yaml_string() of the snapshot.
+class ResumablePatchEmitter {
+public:
+	enum class Status { InProgress, Done, Failed };
+
+	// Called with each piece of output, in order. Returning false (e.g. on a write
+	// error) stops the emitter.
+	using Sink = std::function<bool(std::string_view)>;
+
+	ResumablePatchEmitter(PatchData const &pd,
+						  Sink sink,
+						  PatchWriteOptions const &options = {},
+						  size_t chunk_bytes = 4096);
+	ResumablePatchEmitter(PatchData &&pd, Sink sink, PatchWriteOptions const &options = {}, size_t chunk_bytes = 4096);
+	~ResumablePatchEmitter();
+
+	// Writes one piece of about chunk_bytes, or pieces until at least max_bytes are written
+	Status step(size_t max_bytes = 0);
+
+	// Writes pieces while keep_going() returns true, e.g. until a deadline. At least one
+	// piece is written per call.
+	template<typename F>
+	Status step_while(F &&keep_going) {
+		Status s;
+		do {
+			s = step();
+		} while (s == Status::InProgress && keep_going());
+		return s;
+	}
+
+	Status status() const;
+	size_t bytes_written() const;
+
+private:
+	struct State;
+	std::unique_ptr<State> state;
+};
+
 } // namespace MetaModule
@@ -0,0 +1,174 @@
+#include "patch_trace.hh"
+#include <chrono>
+#include <cstdio>
+
+#if METAMODULE_PATCH_TRACE_THREADS
+#include <atomic>
+#include <thread>
+#endif
+
+namespace MetaModule
+{
+
+namespace
+{
+
+struct TraceTarget {
+	PatchTraceCallback callback = nullptr;
+	void *context = nullptr;
+};
+
+class Lock {
+public:
+	explicit Lock(PatchTrace::Mutex &m)
+		: m{m} {
+		m.lock();
+	}
+	~Lock() {
+		m.unlock();
+	}
+
+private:
+	PatchTrace::Mutex &m;
+};
+
+PatchTrace::Mutex trace_mutex;
+TraceTarget trace_target;
+
+#if METAMODULE_PATCH_TRACE_THREADS
+// Loads may run on a worker thread (AsyncPatchLoad) while the callback is changed. The
+// callback and its context are read and written together under the lock, but called
+// without it. Replacing the callback waits for the reports already running, so the old
+// one isn't called once set_patch_trace_callback() returns.
+std::atomic<bool> trace_enabled = false;
+std::atomic<unsigned> reports_running = 0;
+thread_local unsigned callback_depth = 0;
+
+void wait_for_reports() {
+	// A callback replacing itself would wait for its own report
+	if (callback_depth)
+		return;
+	while (reports_running.load() != 0)
+		std::this_thread::yield();
+}
+#else
+bool trace_enabled = false;
+
+void wait_for_reports() {
+}
+#endif
+
+} // namespace
+
+void set_patch_trace_callback(PatchTraceCallback callback, void *context) {
+	{
+		Lock lock{trace_mutex};
+		trace_target = {callback, context};
+		trace_enabled = callback != nullptr;
+	}
+	wait_for_reports();
+}
+
+namespace PatchTrace
+{
+
+bool enabled() {
+	return trace_enabled;
+}
+
+uint64_t now_ns() {
+	auto t = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+void report(PatchTraceEvent const &event) {
+#if METAMODULE_PATCH_TRACE_THREADS
+	// Counted before reading the target, so a caller replacing it sees this report
+	reports_running++;
+	callback_depth++;
+#endif
+
+	TraceTarget target;
+	{
+		Lock lock{trace_mutex};
+		target = trace_target;
+	}
+	if (target.callback)
+		target.callback(event, target.context);
+
+#if METAMODULE_PATCH_TRACE_THREADS
+	callback_depth--;
+	reports_running--;
+#endif
+}
+
+} // namespace PatchTrace
+
+void ChromeTraceWriter::install() {
+	set_patch_trace_callback(
+		[](PatchTraceEvent const &event, void *context) { static_cast<ChromeTraceWriter *>(context)->add(event); },
+		this);
+}
+
+void ChromeTraceWriter::uninstall() {
+	{
+		Lock lock{trace_mutex};
+		if (trace_target.context != this)
+			return;
+		trace_target = {};
+		trace_enabled = false;
+	}
+	wait_for_reports();
+}
+
+void ChromeTraceWriter::add(PatchTraceEvent const &event) {
+	Lock lock{mutex};
+	events_.push_back(event);
+}
+
+void ChromeTraceWriter::clear() {
+	Lock lock{mutex};
+	events_.clear();
+}
+
+std::vector<PatchTraceEvent> ChromeTraceWriter::snapshot() const {
+	Lock lock{mutex};
+	return events_;
+}
+
+std::string ChromeTraceWriter::json() const {
+	Lock lock{mutex};
+	std::string out = "{\"traceEvents\":[\n";
+	char buf[256];
+
+	for (size_t i = 0; auto const &e : events_) {
+		// Complete events ("ph":"X"), with timestamps in microseconds
+		snprintf(buf,
+				 sizeof buf,
+				 "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,"
+				 "\"args\":{\"bytes\":%zu,\"count\":%zu}}%s\n",
+				 e.name,
+				 e.category,
+				 double(e.start_ns) / 1000.,
+				 double(e.duration_ns) / 1000.,
+				 e.bytes,
+				 e.count,
+				 ++i < events_.size() ? "," : "");
+		out += buf;
+	}
+
+	out += "]}\n";
+	return out;
+}
+
+bool ChromeTraceWriter::write_file(const char *path) const {
+	auto f = fopen(path, "w");
+	if (!f)
+		return false;
+
+	auto s = json();
+	bool ok = fwrite(s.data(), 1, s.size(), f) == s.size();
+	return (fclose(f) == 0) && ok;
+}
+
+} // namespace MetaModule
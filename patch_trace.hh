@@ -0,0 +1,131 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tracing of the time spent in each section of a patch load or save.
+//
+// Tracing is compiled in only when METAMODULE_PATCH_TRACE is defined. Otherwise the
+// PATCH_TRACE_* macros expand to nothing, and the callback is never called.
+//
+// With tracing on a host, loads may be traced from several threads. Single-threaded
+// targets (bare-metal builds) have no std::mutex, and use no locks.
+#if defined(METAMODULE_PATCH_TRACE) && (defined(_GLIBCXX_HAS_GTHREADS) || defined(_LIBCPP_VERSION) || defined(_MSC_VER))
+#define METAMODULE_PATCH_TRACE_THREADS 1
+#include <mutex>
+#else
+#define METAMODULE_PATCH_TRACE_THREADS 0
+#endif
+
+namespace MetaModule
+{
+
+struct PatchTraceEvent {
+	const char *category; // "load" or "save"
+	const char *name;	  // "parse", "emit", or a PatchData section such as "int_cables"
+	uint64_t start_ns;	  // steady clock
+	uint64_t duration_ns;
+	size_t bytes; // bytes of yaml read or produced by this step
+	size_t count; // elements in the section
+};
+
+using PatchTraceCallback = void (*)(PatchTraceEvent const &event, void *context);
+
+// Pass nullptr to stop tracing. May be called while a load is running on another thread:
+// it waits for reports already running, so once it returns the old callback is not
+// called again. The callback may call this too, but then doesn't wait.
+void set_patch_trace_callback(PatchTraceCallback callback, void *context = nullptr);
+
+namespace PatchTrace
+{
+
+#if METAMODULE_PATCH_TRACE_THREADS
+using Mutex = std::mutex;
+#else
+struct Mutex {
+	void lock() {
+	}
+	void unlock() {
+	}
+};
+#endif
+
+bool enabled();
+uint64_t now_ns();
+void report(PatchTraceEvent const &event);
+
+// Measures from construction until end() is called
+class Span {
+public:
+	Span(const char *category, const char *name)
+		: event{category, name, enabled() ? now_ns() : 0, 0, 0, 0} {
+	}
+
+	void end(size_t bytes, size_t count) {
+		if (!event.start_ns)
+			return;
+		event.duration_ns = now_ns() - event.start_ns;
+		event.bytes = bytes;
+		event.count = count;
+		report(event);
+		event.start_ns = 0;
+	}
+
+	bool active() const {
+		return event.start_ns != 0;
+	}
+
+private:
+	PatchTraceEvent event;
+};
+
+} // namespace PatchTrace
+
+// Collects events and writes them in the Chrome trace event format, for
+// chrome://tracing or https://ui.perfetto.dev
+//
+// Events may be added from several threads at once, on hosts (see above).
+class ChromeTraceWriter {
+public:
+	// Makes this the trace callback. Call uninstall() before destroying it.
+	void install();
+	void uninstall();
+
+	void add(PatchTraceEvent const &event);
+	void clear();
+
+	// Only while no traced load or save is running
+	std::vector<PatchTraceEvent> const &events() const {
+		return events_;
+	}
+
+	// A copy of the events, safe to take while loads are running
+	std::vector<PatchTraceEvent> snapshot() const;
+
+	std::string json() const;
+	bool write_file(const char *path) const;
+
+private:
+	mutable PatchTrace::Mutex mutex;
+	std::vector<PatchTraceEvent> events_;
+};
+
+} // namespace MetaModule
+
+#if defined(METAMODULE_PATCH_TRACE)
+#define PATCH_TRACE_BEGIN(var, category, name) ::MetaModule::PatchTrace::Span var{category, name}
+// bytes and count are only evaluated while tracing
+#define PATCH_TRACE_END(var, bytes, count)                                                                             \
+	do {                                                                                                               \
+		if (var.active())                                                                                              \
+			var.end(bytes, count);                                                                                     \
+	} while (0)
+#else
+#define PATCH_TRACE_BEGIN(var, category, name)                                                                         \
+	do {                                                                                                               \
+	} while (0)
+#define PATCH_TRACE_END(var, bytes, count)                                                                             \
+	do {                                                                                                               \
+	} while (0)
+#endif
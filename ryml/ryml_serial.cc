@@ -5,6 +5,7 @@
 #include "patch/patch.hh"
 #include "ryml.hpp"
 #include "ryml_serial_chars.hh"
+#include <span>
 
 void write(ryml::NodeRef *n, Jack const &jack) {
 	*n |= ryml::MAP;
@@ -18,8 +19,8 @@ void write(ryml::NodeRef *n, MappedKnob const &mapped_knob) {
 	n->append_child() << ryml::key("module_id") << mapped_knob.module_id;
 	n->append_child() << ryml::key("param_id") << mapped_knob.param_id;
 	n->append_child() << ryml::key("curve_type") << mapped_knob.curve_type;
-	n->append_child() << ryml::key("min") << mapped_knob.min;
-	n->append_child() << ryml::key("max") << mapped_knob.max;
+	n->append_child() << ryml::key("min") << ShortFloat{mapped_knob.min};
+	n->append_child() << ryml::key("max") << ShortFloat{mapped_knob.max};
 	if (mapped_knob.alias_name.length())
 		n->append_child() << ryml::key("alias_name") << mapped_knob.alias_name;
 	if (mapped_knob.midi_chan > 0)
@@ -61,12 +62,16 @@ void write(ryml::NodeRef *n, StaticParam const &k) {
 	*n |= ryml::MAP;
 	n->append_child() << ryml::key("module_id") << k.module_id;
 	n->append_child() << ryml::key("param_id") << k.param_id;
-	n->append_child() << ryml::key("value") << k.value;
+	n->append_child() << ryml::key("value") << ShortFloat{k.value};
 }
 
 void write(ryml::NodeRef *n, std::vector<BrandModuleSlug> const &slugs) {
+	write_slugs(n, slugs, 0);
+}
+
+void write_slugs(ryml::NodeRef *n, std::span<const BrandModuleSlug> slugs, size_t first_index) {
 	*n |= ryml::MAP;
-	for (unsigned i = 0; auto const &x : slugs) {
+	for (size_t i = first_index; auto const &x : slugs) {
 		auto idx_s = std::to_string(i);
 		ryml::csubstr idx(idx_s.c_str(), idx_s.length());
 		ryml::csubstr slug(x.c_str(), x.length());
@@ -93,7 +98,8 @@ void write(ryml::NodeRef *n, ModuleInitState const &state) {
 	auto data_node = n->append_child();
 	data_node |= ryml::_WIP_VAL_LITERAL;
 
-	data_node << ryml::key("data") << state.state_data;
+	auto data = state.data();
+	data_node << ryml::key("data") << ryml::csubstr(data.data(), data.size());
 }
 
 void write(ryml::NodeRef *n, MappedLight const &map) {
@@ -103,9 +109,134 @@ void write(ryml::NodeRef *n, MappedLight const &map) {
 	n->append_child() << ryml::key("light_id") << map.light_id;
 }
 
+// Compact forms: flow sequences for records of plain numbers, and single-line flow maps
+// for records without free text. Records with an alias name stay in block style, so the
+// name never needs quoting. The readers accept both forms.
+
+void write_compact(ryml::NodeRef *n, Jack const &jack) {
+	*n |= ryml::SEQ;
+	*n |= ryml::_WIP_STYLE_FLOW_SL;
+	n->append_child() << jack.module_id;
+	n->append_child() << jack.jack_id;
+}
+
+void write_compact(ryml::NodeRef *n, StaticParam const &k) {
+	*n |= ryml::SEQ;
+	*n |= ryml::_WIP_STYLE_FLOW_SL;
+	n->append_child() << k.module_id;
+	n->append_child() << k.param_id;
+	n->append_child() << ShortFloat{k.value};
+}
+
+void write_compact(ryml::NodeRef *n, MappedLight const &map) {
+	*n |= ryml::SEQ;
+	*n |= ryml::_WIP_STYLE_FLOW_SL;
+	n->append_child() << map.panel_light_id;
+	n->append_child() << map.module_id;
+	n->append_child() << map.light_id;
+}
+
+template<typename T>
+static void write_compact_seq(ryml::NodeRef *n, std::vector<T> const &v) {
+	*n |= ryml::SEQ;
+	for (auto const &x : v) {
+		auto child = n->append_child();
+		write_compact(&child, x);
+	}
+}
+
+static void write_compact_child(ryml::NodeRef *n, const char *key, auto const &val) {
+	auto child = n->append_child();
+	child << ryml::key(ryml::to_csubstr(key));
+	write_compact(&child, val);
+}
+
+void write_compact(ryml::NodeRef *n, std::vector<Jack> const &jacks) {
+	write_compact_seq(n, jacks);
+	*n |= ryml::_WIP_STYLE_FLOW_SL;
+}
+
+void write_compact(ryml::NodeRef *n, InternalCable const &cable) {
+	*n |= ryml::MAP;
+	*n |= ryml::_WIP_STYLE_FLOW_SL;
+	write_compact_child(n, "out", cable.out);
+	write_compact_child(n, "ins", cable.ins);
+	if (cable.color.has_value()) {
+		n->append_child() << ryml::key("color") << cable.color.value();
+	}
+}
+
+void write_compact(ryml::NodeRef *n, MappedInputJack const &j) {
+	*n |= ryml::MAP;
+	if (j.alias_name.length() == 0)
+		*n |= ryml::_WIP_STYLE_FLOW_SL;
+	n->append_child() << ryml::key("panel_jack_id") << j.panel_jack_id;
+	write_compact_child(n, "ins", j.ins);
+	if (j.alias_name.length())
+		n->append_child() << ryml::key("alias_name") << j.alias_name;
+}
+
+void write_compact(ryml::NodeRef *n, MappedOutputJack const &j) {
+	*n |= ryml::MAP;
+	if (j.alias_name.length() == 0)
+		*n |= ryml::_WIP_STYLE_FLOW_SL;
+	n->append_child() << ryml::key("panel_jack_id") << j.panel_jack_id;
+	write_compact_child(n, "out", j.out);
+	if (j.alias_name.length())
+		n->append_child() << ryml::key("alias_name") << j.alias_name;
+}
+
+void write_compact(ryml::NodeRef *n, MappedKnob const &mapped_knob) {
+	write(n, mapped_knob);
+	if (mapped_knob.alias_name.length() == 0)
+		*n |= ryml::_WIP_STYLE_FLOW_SL;
+}
+
+void write_compact(ryml::NodeRef *n, MappedKnobSet const &knob_set) {
+	*n |= ryml::MAP;
+	n->append_child() << ryml::key("name") << knob_set.name;
+	write_compact_child(n, "set", knob_set.set);
+}
+
+void write_compact(ryml::NodeRef *n, std::vector<InternalCable> const &v) {
+	write_compact_seq(n, v);
+}
+
+void write_compact(ryml::NodeRef *n, std::vector<MappedInputJack> const &v) {
+	write_compact_seq(n, v);
+}
+
+void write_compact(ryml::NodeRef *n, std::vector<MappedOutputJack> const &v) {
+	write_compact_seq(n, v);
+}
+
+void write_compact(ryml::NodeRef *n, std::vector<StaticParam> const &v) {
+	write_compact_seq(n, v);
+}
+
+void write_compact(ryml::NodeRef *n, std::vector<MappedKnob> const &v) {
+	write_compact_seq(n, v);
+}
+
+void write_compact(ryml::NodeRef *n, std::vector<MappedKnobSet> const &v) {
+	write_compact_seq(n, v);
+}
+
+void write_compact(ryml::NodeRef *n, std::vector<MappedLight> const &v) {
+	write_compact_seq(n, v);
+}
+
 bool read(ryml::ConstNodeRef const &n, Jack *jack) {
 	if (n.num_children() < 2)
 		return false;
+
+	// Compact form: [module_id, jack_id]
+	if (n.is_seq()) {
+		n.child(0) >> jack->module_id;
+		n.child(1) >> jack->jack_id;
+		return true;
+	}
+
 	if (!n.is_map())
 		return false;
 	if (!n.has_child("module_id"))
@@ -218,8 +349,8 @@ bool read(ryml::ConstNodeRef const &n, MappedKnob *k) {
 	n["module_id"] >> k->module_id;
 	n["param_id"] >> k->param_id;
 	n["curve_type"] >> k->curve_type;
-	n["min"] >> k->min;
-	n["max"] >> k->max;
+	read_float(n["min"], &k->min);
+	read_float(n["max"], &k->max);
 
 	if (n.has_child("midi_chan"))
 		n["midi_chan"] >> k->midi_chan;
@@ -257,6 +388,15 @@ bool read(ryml::ConstNodeRef const &n, MappedKnobSet *ks) {
 bool read(ryml::ConstNodeRef const &n, StaticParam *k) {
 	if (n.num_children() < 3)
 		return false;
+
+	// Compact form: [module_id, param_id, value]
+	if (n.is_seq()) {
+		n.child(0) >> k->module_id;
+		n.child(1) >> k->param_id;
+		read_float(n.child(2), &k->value);
+		return true;
+	}
+
 	if (!n.is_map())
 		return false;
 	if (!n.has_child("module_id"))
@@ -268,12 +408,12 @@ bool read(ryml::ConstNodeRef const &n, StaticParam *k) {
 
 	n["module_id"] >> k->module_id;
 	n["param_id"] >> k->param_id;
-	n["value"] >> k->value;
+	read_float(n["value"], &k->value);
 
 	return true;
 }
 
-bool read(ryml::ConstNodeRef const &n, ModuleInitState *m) {
+static bool read_state_module_id(ryml::ConstNodeRef const &n, ModuleInitState *m) {
 	if (n.num_children() < 2)
 		return false;
 	if (!n.is_map())
@@ -284,11 +424,35 @@ bool read(ryml::ConstNodeRef const &n, ModuleInitState *m) {
 		return false;
 
 	n["module_id"] >> m->module_id;
+	return true;
+}
+
+bool read(ryml::ConstNodeRef const &n, ModuleInitState *m) {
+	if (!read_state_module_id(n, m))
+		return false;
 
 	// Copy the data field as a string
 	// Modules will decide how to deserialize
 
 	n["data"] >> m->state_data;
+	m->state_view = {};
+	return true;
+}
+
+bool read(ryml::ConstNodeRef const &n, ModuleInitState *m, std::span<const char> source) {
+	if (!read_state_module_id(n, m))
+		return false;
+
+	// Keep a view if the parser left the data in the source buffer.
+	// Scalars that the parser had to rewrite elsewhere (into the tree's arena) are copied.
+	auto val = n["data"].val();
+	if (val.str >= source.data() && val.str + val.len <= source.data() + source.size()) {
+		m->state_view = {val.str, val.len};
+		m->state_data.clear();
+	} else {
+		n["data"] >> m->state_data;
+		m->state_view = {};
+	}
 	return true;
 }
 
@@ -313,6 +477,15 @@ bool read(ryml::ConstNodeRef const &n, ModuleAlias *a) {
 bool read(ryml::ConstNodeRef const &n, MappedLight *k) {
 	if (n.num_children() < 3)
 		return false;
+
+	// Compact form: [panel_light_id, module_id, light_id]
+	if (n.is_seq()) {
+		n.child(0) >> k->panel_light_id;
+		n.child(1) >> k->module_id;
+		n.child(2) >> k->light_id;
+		return true;
+	}
+
 	if (!n.is_map())
 		return false;
 	if (!n.has_child("panel_light_id"))
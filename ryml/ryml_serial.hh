@@ -2,6 +2,7 @@
 #include "patch/module_type_slug.hh"
 #include "patch/patch.hh"
 #include "ryml_std.hpp"
+#include <span>
 
 // These must be included after ryml_std.hpp:
 #include "ryml.hpp"
@@ -15,11 +16,31 @@ void write(ryml::NodeRef *n, MappedInputJack const &j);
 void write(ryml::NodeRef *n, MappedOutputJack const &j);
 void write(ryml::NodeRef *n, StaticParam const &k);
 void write(ryml::NodeRef *n, std::vector<BrandModuleSlug> const &slugs);
+// Slugs keyed by index, starting from first_index
+void write_slugs(ryml::NodeRef *n, std::span<const BrandModuleSlug> slugs, size_t first_index);
 void write(ryml::NodeRef *n, std::vector<ModuleTypeSlug> const &slugs);
 void write(ryml::NodeRef *n, ModuleInitState const &state);
 void write(ryml::NodeRef *n, MappedLight const &map);
 void write(ryml::NodeRef *n, ModuleAlias const &a);
 
+// Flow-style forms, for PatchWriteOptions::compact
+void write_compact(ryml::NodeRef *n, Jack const &jack);
+void write_compact(ryml::NodeRef *n, StaticParam const &k);
+void write_compact(ryml::NodeRef *n, MappedLight const &map);
+void write_compact(ryml::NodeRef *n, InternalCable const &cable);
+void write_compact(ryml::NodeRef *n, MappedInputJack const &j);
+void write_compact(ryml::NodeRef *n, MappedOutputJack const &j);
+void write_compact(ryml::NodeRef *n, MappedKnob const &mapped_knob);
+void write_compact(ryml::NodeRef *n, MappedKnobSet const &knob_set);
+void write_compact(ryml::NodeRef *n, std::vector<Jack> const &jacks);
+void write_compact(ryml::NodeRef *n, std::vector<InternalCable> const &v);
+void write_compact(ryml::NodeRef *n, std::vector<MappedInputJack> const &v);
+void write_compact(ryml::NodeRef *n, std::vector<MappedOutputJack> const &v);
+void write_compact(ryml::NodeRef *n, std::vector<StaticParam> const &v);
+void write_compact(ryml::NodeRef *n, std::vector<MappedKnob> const &v);
+void write_compact(ryml::NodeRef *n, std::vector<MappedKnobSet> const &v);
+void write_compact(ryml::NodeRef *n, std::vector<MappedLight> const &v);
+
 bool read(ryml::ConstNodeRef const &n, Jack *jack);
 bool read(ryml::ConstNodeRef const &n, InternalCable *cable);
 bool read(ryml::ConstNodeRef const &n, MappedInputJack *j);
@@ -28,5 +49,6 @@ bool read(ryml::ConstNodeRef const &n, MappedKnob *k);
 bool read(ryml::ConstNodeRef const &n, MappedKnobSet *ks);
 bool read(ryml::ConstNodeRef const &n, StaticParam *k);
 bool read(ryml::ConstNodeRef const &n, ModuleInitState *m);
+bool read(ryml::ConstNodeRef const &n, ModuleInitState *m, std::span<const char> source);
 bool read(ryml::ConstNodeRef const &n, MappedLight *m);
 bool read(ryml::ConstNodeRef const &n, ModuleAlias *a);
@@ -1,6 +1,8 @@
 #include "util/static_string.hh"
 #include <algorithm>
+#include <charconv>
 #include <cstddef>
+#include <cstring>
 
 template<size_t CAPACITY>
 bool from_chars(ryml::csubstr buf, StaticString<CAPACITY> *s) {
@@ -27,3 +29,30 @@ size_t to_chars(ryml::substr buf, StaticString<CAPACITY> s) {
 	}
 	return sz;
 }
+
+// Floats are written in the shortest form that reads back to the exact same value
+// (std::to_chars is Ryu-based), e.g. 0.1f is written as 0.1 and 0.123456789f as 0.12345679.
+// Use `node << ShortFloat{x}` to write and read_float(node, &x) to read.
+struct ShortFloat {
+	float value;
+};
+
+inline size_t to_chars(ryml::substr buf, ShortFloat f) {
+	char tmp[24];
+	auto res = std::to_chars(tmp, tmp + sizeof tmp, f.value);
+	size_t sz = res.ptr - tmp;
+	if (buf.len < sz)
+		return sz;
+	std::memcpy(buf.str, tmp, sz);
+	return sz;
+}
+
+inline bool read_float(ryml::ConstNodeRef const &n, float *f) {
+	auto val = n.val();
+	auto res = std::from_chars(val.begin(), val.end(), *f);
+	if (res.ec == std::errc{} && res.ptr == val.end())
+		return true;
+
+	// Forms std::from_chars doesn't accept, such as a leading '+'
+	return c4::from_chars(val, f);
+}
@@ -0,0 +1,88 @@
+#include "alloc_counter.hh"
+#include "../ryml/ryml_init.hh"
+#include "ryml.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace AllocCounter
+{
+
+static std::atomic<size_t> num_allocs{0};
+static std::atomic<size_t> num_bytes{0};
+static std::atomic<size_t> num_ryml_allocs{0};
+static std::atomic<size_t> num_ryml_bytes{0};
+
+static void *counted_malloc(size_t size) {
+	num_allocs.fetch_add(1, std::memory_order_relaxed);
+	num_bytes.fetch_add(size, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+Counts totals() {
+	return {
+		.allocs = num_allocs.load(std::memory_order_relaxed),
+		.bytes = num_bytes.load(std::memory_order_relaxed),
+		.ryml_allocs = num_ryml_allocs.load(std::memory_order_relaxed),
+		.ryml_bytes = num_ryml_bytes.load(std::memory_order_relaxed),
+	};
+}
+
+void install_ryml_hooks() {
+	static bool installed = false;
+	if (installed)
+		return;
+	installed = true;
+
+	RymlInit::init_once();
+
+	// The previous callbacks do the actual allocating
+	static c4::yml::Callbacks prev = c4::yml::get_callbacks();
+
+	c4::yml::Callbacks callbacks = prev;
+	callbacks.m_allocate = [](size_t len, void *hint, void *user_data) {
+		num_ryml_allocs.fetch_add(1, std::memory_order_relaxed);
+		num_ryml_bytes.fetch_add(len, std::memory_order_relaxed);
+		return prev.m_allocate(len, hint, user_data);
+	};
+	c4::yml::set_callbacks(callbacks);
+}
+
+} // namespace AllocCounter
+
+// Replaceable global allocation functions.
+// The aligned overloads are left to the standard library.
+
+void *operator new(size_t size) {
+	if (auto p = AllocCounter::counted_malloc(size))
+		return p;
+	throw std::bad_alloc{};
+}
+
+void *operator new[](size_t size) {
+	return ::operator new(size);
+}
+
+void *operator new(size_t size, std::nothrow_t const &) noexcept {
+	return AllocCounter::counted_malloc(size);
+}
+
+void *operator new[](size_t size, std::nothrow_t const &) noexcept {
+	return AllocCounter::counted_malloc(size);
+}
+
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+	std::free(p);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+
+// Counts heap allocations made by the test binary, through global operator new
+// and through ryml's allocation callbacks (which use malloc, not operator new).
+namespace AllocCounter
+{
+
+struct Counts {
+	size_t allocs = 0;
+	size_t bytes = 0;
+	size_t ryml_allocs = 0;
+	size_t ryml_bytes = 0;
+
+	size_t total_allocs() const {
+		return allocs + ryml_allocs;
+	}
+
+	size_t total_bytes() const {
+		return bytes + ryml_bytes;
+	}
+};
+
+// Running totals since the program started
+Counts totals();
+
+// Routes ryml's allocations through the counter.
+// Calls RymlInit::init_once() first, so the hooks are not overwritten later.
+void install_ryml_hooks();
+
+// Counts the allocations made by func
+template<typename F>
+Counts count(F &&func) {
+	install_ryml_hooks();
+	auto start = totals();
+	func();
+	auto end = totals();
+	return {
+		.allocs = end.allocs - start.allocs,
+		.bytes = end.bytes - start.bytes,
+		.ryml_allocs = end.ryml_allocs - start.ryml_allocs,
+		.ryml_bytes = end.ryml_bytes - start.ryml_bytes,
+	};
+}
+
+} // namespace AllocCounter
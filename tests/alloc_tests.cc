@@ -0,0 +1,98 @@
+#include "../patch_to_yaml.hh"
+#include "../yaml_to_patch.hh"
+#include "alloc_counter.hh"
+#include "doctest.h"
+#include "patch_generator.hh"
+
+using namespace MetaModule;
+
+// These bounds are deliberately loose. They catch allocations that scale with the
+// size of the patch in the wrong way (e.g. a copy per element in a loop), not a
+// few extra allocations here and there.
+
+// A patch where nearly everything is cables
+static PatchData cable_patch(unsigned num_cables) {
+	return generate_patch({
+		.seed = num_cables,
+		.num_modules = num_cables / 2,
+		.cables_per_module = 2,
+		.knobs_per_module = 0,
+		.num_knob_sets = 1,
+		.mappings_per_set = 4,
+		.num_midi_maps = 0,
+		.state_fraction = 0,
+	});
+}
+
+// Number of heap-allocated elements a loaded patch needs
+static size_t num_alloc_elements(PatchData const &pd) {
+	return pd.int_cables.size() + pd.mapped_ins.size() + pd.module_states.size();
+}
+
+TEST_CASE("Parsing allocates at most a few times per cable") {
+	for (unsigned num_cables : {100, 1000, 10000}) {
+		auto yaml = patch_to_yaml_string(cable_patch(num_cables));
+
+		PatchData pd;
+		auto counts = AllocCounter::count([&] { yaml_raw_to_patch(yaml.data(), yaml.size(), pd); });
+
+		CHECK(counts.total_allocs() <= 4 * num_alloc_elements(pd) + 256);
+	}
+}
+
+TEST_CASE("Parsing a full patch allocates in proportion to its contents") {
+	for (unsigned num_modules : {10, 100, 1000}) {
+		auto yaml = patch_to_yaml_string(generate_patch({.seed = 1, .num_modules = num_modules, .state_size = 64}));
+
+		PatchData pd;
+		auto counts = AllocCounter::count([&] { yaml_raw_to_patch(yaml.data(), yaml.size(), pd); });
+
+		CHECK(counts.total_allocs() <= 4 * num_alloc_elements(pd) + 256);
+		// Everything allocated is either the tree, the patch, or growth headroom
+		CHECK(counts.total_bytes() <= 16 * yaml.size() + 64 * 1024);
+	}
+}
+
+TEST_CASE("Writing allocates a bounded number of times") {
+	for (unsigned num_modules : {10, 100, 1000}) {
+		auto pd = generate_patch({.seed = 2, .num_modules = num_modules});
+
+		std::string yaml;
+		auto counts = AllocCounter::count([&] { yaml = patch_to_yaml_string(pd); });
+		// One std::string per module slug key, plus tree and string growth
+		CHECK(counts.total_allocs() <= 2 * pd.module_slugs.size() + 256);
+
+		std::vector<char> out(yaml.size() * 2);
+		std::span<char> buffer{out};
+		counts = AllocCounter::count([&] { patch_to_yaml_buffer(pd, buffer); });
+		CHECK(counts.total_allocs() <= 2 * pd.module_slugs.size() + 256);
+	}
+}
+
+TEST_CASE("PatchData mutators do not copy elements") {
+	auto pd = generate_patch({.seed = 3, .num_modules = 500, .cables_per_module = 3});
+	REQUIRE(pd.int_cables.size() > 1000);
+
+	auto counts = AllocCounter::count([&] { pd.disconnect_injack(pd.int_cables[10].ins[0]); });
+	CHECK(counts.allocs == 0);
+
+	counts = AllocCounter::count([&] { pd.disconnect_outjack(pd.int_cables[20].out); });
+	CHECK(counts.allocs == 0);
+
+	counts = AllocCounter::count([&] { pd.remove_injack_mappings(pd.mapped_ins[0].ins[0]); });
+	CHECK(counts.allocs == 0);
+
+	counts = AllocCounter::count([&] { pd.remove_module(250); });
+	CHECK(counts.allocs == 0);
+
+	counts = AllocCounter::count([&] { pd.set_or_add_static_knob_value(100, 2, 0.5f); });
+	CHECK(counts.allocs == 0);
+
+	// Adding elements may grow a vector, but only once
+	counts = AllocCounter::count([&] { pd.add_internal_cable({40, 1}, {41, 7}); });
+	CHECK(counts.allocs <= 2);
+
+	counts = AllocCounter::count(
+		[&] { pd.add_update_mapped_knob(0, {.panel_knob_id = 3, .module_id = 50, .param_id = 1, .min = 0, .max = 1}); });
+	CHECK(counts.allocs <= 1);
+}
@@ -0,0 +1,73 @@
+#include "../async_patch_load.hh"
+#include "../patch_to_yaml.hh"
+#include "doctest.h"
+#include "patch/patch_hash.hh"
+#include "patch_generator.hh"
+#include <atomic>
+#include <string>
+#include <vector>
+
+using namespace MetaModule;
+
+TEST_CASE("Async load produces the same patch as a synchronous load") {
+	auto orig = generate_patch({.seed = 7, .num_modules = 200});
+	auto yaml = patch_to_yaml_string(orig);
+
+	std::vector<std::string> sections;
+	unsigned num_sections = 0;
+
+	AsyncPatchLoad load{yaml, [&](PatchLoadProgress const &p) {
+							sections.push_back(p.section);
+							num_sections = p.num_sections;
+						}};
+
+	REQUIRE(load.wait() == AsyncPatchLoad::Status::Done);
+	CHECK(load.status() == AsyncPatchLoad::Status::Done);
+	CHECK(patch_hash(load.patch()) == patch_hash(orig));
+
+	REQUIRE(sections.size() > 2);
+	CHECK(sections.front() == "parse");
+	CHECK(sections[1] == "module_slugs");
+	CHECK(sections.size() == num_sections + 1);
+}
+
+TEST_CASE("Async load can be cancelled") {
+	auto yaml = patch_to_yaml_string(generate_patch({.seed = 8, .num_modules = 200}));
+
+	SUBCASE("by the caller") {
+		std::atomic<bool> cancelled = false;
+		std::vector<std::string> sections;
+
+		AsyncPatchLoad load{yaml, [&](PatchLoadProgress const &p) {
+								sections.push_back(p.section);
+								// Hold the worker on the first section until the caller cancels
+								if (p.sections_read == 0 && p.num_sections)
+									cancelled.wait(false);
+							}};
+		load.cancel();
+		cancelled = true;
+		cancelled.notify_all();
+
+		CHECK(load.wait() == AsyncPatchLoad::Status::Cancelled);
+		CHECK(sections.size() <= 2);
+	}
+
+	SUBCASE("by the load options") {
+		PatchLoadOptions options;
+		options.on_progress = [](PatchLoadProgress const &p, void *) { return p.sections_read < 2; };
+
+		AsyncPatchLoad load{yaml, {}, options};
+		CHECK(load.wait() == AsyncPatchLoad::Status::Cancelled);
+	}
+
+	SUBCASE("by destroying the loader") {
+		for (unsigned i = 0; i < 8; i++) {
+			AsyncPatchLoad load{yaml};
+		}
+	}
+}
+
+TEST_CASE("Async load reports invalid yaml as failed") {
+	AsyncPatchLoad load{"PatchData:\n  description: no name\n"};
+	CHECK(load.wait() == AsyncPatchLoad::Status::Failed);
+}
@@ -0,0 +1,209 @@
+#include "../base64.hh"
+#include "doctest.h"
+#include <array>
+#include <string>
+#include <vector>
+
+using namespace MetaModule;
+
+static std::span<const uint8_t> as_bytes(std::string_view s) {
+	return {reinterpret_cast<const uint8_t *>(s.data()), s.size()};
+}
+
+static std::string as_string(std::vector<uint8_t> const &v) {
+	return {v.begin(), v.end()};
+}
+
+static std::vector<uint8_t> test_bytes(size_t size) {
+	std::vector<uint8_t> v(size);
+	uint32_t x = 0x12345678;
+	for (auto &b : v) {
+		x = x * 1664525 + 1013904223;
+		b = x >> 24;
+	}
+	return v;
+}
+
+// Simple reference encoder to compare the vector kernels against
+static std::string reference_encode(std::span<const uint8_t> in) {
+	std::string out;
+	for (size_t i = 0; i < in.size(); i += 3) {
+		uint32_t v = in[i] << 16;
+		if (i + 1 < in.size())
+			v |= in[i + 1] << 8;
+		if (i + 2 < in.size())
+			v |= in[i + 2];
+		out.push_back(Base64Detail::encode_table[v >> 18]);
+		out.push_back(Base64Detail::encode_table[(v >> 12) & 0x3F]);
+		out.push_back(i + 1 < in.size() ? Base64Detail::encode_table[(v >> 6) & 0x3F] : '=');
+		out.push_back(i + 2 < in.size() ? Base64Detail::encode_table[v & 0x3F] : '=');
+	}
+	return out;
+}
+
+TEST_CASE("Base64 RFC 4648 test vectors") {
+	CHECK(Base64::encode(as_bytes("")) == "");
+	CHECK(Base64::encode(as_bytes("f")) == "Zg==");
+	CHECK(Base64::encode(as_bytes("fo")) == "Zm8=");
+	CHECK(Base64::encode(as_bytes("foo")) == "Zm9v");
+	CHECK(Base64::encode(as_bytes("foob")) == "Zm9vYg==");
+	CHECK(Base64::encode(as_bytes("fooba")) == "Zm9vYmE=");
+	CHECK(Base64::encode(as_bytes("foobar")) == "Zm9vYmFy");
+
+	CHECK(as_string(Base64::decode("")) == "");
+	CHECK(as_string(Base64::decode("Zg==")) == "f");
+	CHECK(as_string(Base64::decode("Zm8=")) == "fo");
+	CHECK(as_string(Base64::decode("Zm9v")) == "foo");
+	CHECK(as_string(Base64::decode("Zm9vYg==")) == "foob");
+	CHECK(as_string(Base64::decode("Zm9vYmE=")) == "fooba");
+	CHECK(as_string(Base64::decode("Zm9vYmFy")) == "foobar");
+}
+
+TEST_CASE("Base64 matches the reference encoder for all alphabet chars and lengths") {
+	for (size_t size = 0; size < 200; size++) {
+		auto raw = test_bytes(size);
+		auto encoded = Base64::encode(raw);
+		CHECK(encoded == reference_encode(raw));
+		CHECK(Base64::decode(encoded) == raw);
+	}
+
+	std::vector<uint8_t> all(256 * 3);
+	for (size_t i = 0; i < all.size(); i++)
+		all[i] = i / 3;
+	CHECK(Base64::encode(all) == reference_encode(all));
+	CHECK(Base64::decode(Base64::encode(all)) == all);
+}
+
+TEST_CASE("Base64 decode skips line breaks and spaces") {
+	auto raw = test_bytes(1000);
+	auto encoded = Base64::encode(raw);
+
+	std::string wrapped;
+	for (size_t i = 0; i < encoded.size(); i += 76) {
+		wrapped += encoded.substr(i, 76);
+		wrapped += "\n";
+	}
+	CHECK(Base64::decode(wrapped) == raw);
+
+	// Breaks at odd positions, inside quads
+	std::string ragged;
+	for (size_t i = 0; i < encoded.size(); i += 13) {
+		ragged += encoded.substr(i, 13);
+		ragged += (i % 2) ? "\r\n" : "  \t";
+	}
+	CHECK(Base64::decode(ragged) == raw);
+}
+
+TEST_CASE("Base64 decode rejects invalid input") {
+	CHECK(Base64::decode("Zm9v!mFy").empty());
+	CHECK(Base64::decode("Zg==Zg==").empty());
+	CHECK(Base64::decode("Z").empty());
+	CHECK(Base64::decode("AAAAAAAAAAAAAAAAAAAAAAAA\x80""AAAAAAA").empty());
+}
+
+TEST_CASE("Base64 decode accepts input without padding") {
+	CHECK(as_string(Base64::decode("Zg")) == "f");
+	CHECK(as_string(Base64::decode("Zm8")) == "fo");
+}
+
+TEST_CASE("Base64 decoded_size is exact") {
+	for (size_t size = 0; size < 40; size++) {
+		auto encoded = Base64::encode(test_bytes(size));
+		CHECK(Base64::decoded_size(encoded) == size);
+
+		encoded.insert(encoded.size() / 2, "\n  ");
+		CHECK(Base64::decoded_size(encoded) == size);
+	}
+	static_assert(Base64::decoded_size("Zm9vYmE=") == 5);
+}
+
+TEST_CASE("Base64 decode_into a caller's buffer") {
+	for (size_t size = 0; size < 100; size++) {
+		auto raw = test_bytes(size);
+		auto encoded = Base64::encode(raw);
+
+		// Buffer of exactly the decoded size
+		std::vector<uint8_t> exact(Base64::decoded_size(encoded));
+		auto written = Base64::decode_into(encoded, exact);
+		REQUIRE(written.has_value());
+		CHECK(*written == size);
+		CHECK(exact == raw);
+
+		// Buffer one byte too small
+		if (size > 0) {
+			std::vector<uint8_t> small(size - 1);
+			CHECK_FALSE(Base64::decode_into(encoded, small).has_value());
+		}
+	}
+
+	std::vector<uint8_t> buffer(16);
+	CHECK_FALSE(Base64::decode_into("Zm9v*mFy", buffer).has_value());
+}
+
+TEST_CASE("Base64 decode_in_place reuses the source buffer") {
+	auto raw = test_bytes(1000);
+	auto encoded = Base64::encode(raw);
+	encoded.insert(300, "\n");
+
+	auto decoded = Base64::decode_in_place(encoded);
+	CHECK(reinterpret_cast<char *>(decoded.data()) == encoded.data());
+	CHECK(std::vector<uint8_t>(decoded.begin(), decoded.end()) == raw);
+}
+
+TEST_CASE("Base64 streaming encoder matches one-shot encode for any chunking") {
+	auto raw = test_bytes(5000);
+	auto expected = Base64::encode(raw);
+
+	for (size_t chunk_size : {1, 2, 3, 4, 5, 16, 17, 100, 4096}) {
+		Base64::Encoder encoder;
+		std::string out;
+		std::vector<char> buf(Base64::Encoder::max_output_size(chunk_size));
+
+		for (size_t i = 0; i < raw.size(); i += chunk_size) {
+			auto chunk = std::span{raw}.subspan(i, std::min(chunk_size, raw.size() - i));
+			auto n = encoder.encode(chunk, buf);
+			REQUIRE(n.has_value());
+			out.append(buf.data(), *n);
+		}
+		std::array<char, Base64::Encoder::MaxFinishSize> tail;
+		out.append(tail.data(), encoder.finish(tail));
+
+		CHECK(out == expected);
+	}
+}
+
+TEST_CASE("Base64 streaming decoder matches one-shot decode for any chunking") {
+	auto raw = test_bytes(5000);
+	auto encoded = Base64::encode(raw);
+
+	// Wrapped, as it appears in a YAML literal block
+	std::string wrapped;
+	for (size_t i = 0; i < encoded.size(); i += 76)
+		wrapped.append(encoded, i, 76).push_back('\n');
+
+	for (size_t chunk_size : {1, 2, 3, 5, 16, 17, 77, 4096}) {
+		Base64::Decoder decoder;
+		std::vector<uint8_t> out;
+		std::vector<uint8_t> buf(Base64::Decoder::max_output_size(chunk_size));
+
+		for (size_t i = 0; i < wrapped.size(); i += chunk_size) {
+			auto n = decoder.decode(std::string_view{wrapped}.substr(i, chunk_size), buf);
+			REQUIRE(n.has_value());
+			out.insert(out.end(), buf.begin(), buf.begin() + *n);
+		}
+		std::array<uint8_t, Base64::Decoder::MaxFinishSize> tail;
+		auto n = decoder.finish(tail);
+		REQUIRE(n.has_value());
+		out.insert(out.end(), tail.begin(), tail.begin() + *n);
+
+		CHECK(out == raw);
+	}
+}
+
+TEST_CASE("Base64 streaming decoder reports errors") {
+	Base64::Decoder decoder;
+	std::array<uint8_t, 16> buf;
+	CHECK(decoder.decode("Zm9v", buf).has_value());
+	CHECK_FALSE(decoder.decode("Zm*v", buf).has_value());
+	CHECK_FALSE(decoder.decode("Zm9v", buf).has_value());
+}
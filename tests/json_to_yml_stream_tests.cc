@@ -0,0 +1,136 @@
+#include "../json_to_yml_stream.hh"
+#include "../yaml_to_patch.hh"
+#include "alloc_counter.hh"
+#include "doctest.h"
+#include <string>
+
+using namespace MetaModule;
+
+static std::string convert(std::string_view json, bool *ok = nullptr) {
+	std::string yaml;
+	bool result = json_to_yml_stream(json, [&](std::string_view piece) {
+		yaml += piece;
+		return true;
+	});
+	if (ok)
+		*ok = result;
+	return result ? yaml : "";
+}
+
+TEST_CASE("JSON is converted to block yaml") {
+	std::string json = R"({"PatchData": {"patch_name": "Test Patch", "description": "line\nline2 \/ x",
+		"module_slugs": {"0": "HubMedium", "1": "Braids"},
+		"int_cables": [{"out": {"module_id": 1, "jack_id": 2}, "ins": [{"module_id": 3, "jack_id": 4}], "color": 1}],
+		"mapped_ins": [], "empty": {}, "nested": [[1, 2], [], {"a": true, "b": null}], "num": -1.5e3, "flag": "true"}})";
+
+	CHECK(convert(json) ==
+		  // clang-format off
+R"(PatchData:
+  patch_name: "Test Patch"
+  description: "line\nline2 / x"
+  module_slugs:
+    "0": HubMedium
+    "1": Braids
+  int_cables:
+    - out:
+        module_id: 1
+        jack_id: 2
+      ins:
+        - module_id: 3
+          jack_id: 4
+      color: 1
+  mapped_ins: []
+  empty: {}
+  nested:
+    - - 1
+      - 2
+    - []
+    - a: true
+      b: null
+  num: -1.5e3
+  flag: "true"
+)");
+	// clang-format on
+
+	// Fed a byte at a time, the output is the same
+	std::string yaml;
+	JsonToYmlStream converter{[&](std::string_view piece) {
+		yaml += piece;
+		return true;
+	}};
+	for (auto c : json)
+		REQUIRE(converter.feed({&c, 1}));
+	REQUIRE(converter.finish());
+	CHECK(yaml == convert(json));
+}
+
+TEST_CASE("Converted JSON loads as a patch") {
+	std::string json = R"({"PatchData": {"patch_name": "From JSON", "module_slugs": {"0": "HubMedium", "1": "Braids"},
+		"int_cables": [{"out": {"module_id": 1, "jack_id": 0}, "ins": [{"module_id": 0, "jack_id": 2}]}],
+		"mapped_ins": [], "mapped_outs": [],
+		"vcvModuleStates": [{"module_id": 1, "data": "{\"model\": 3, \"path\": \"C:\\\\samples\"}"}]}})";
+
+	PatchData pd;
+	REQUIRE(yaml_string_to_patch(convert(json), pd));
+	CHECK(pd.patch_name == "From JSON");
+	REQUIRE(pd.module_slugs.size() == 2);
+	CHECK(pd.module_slugs[1] == "Braids");
+	REQUIRE(pd.int_cables.size() == 1);
+	CHECK(pd.int_cables[0].ins[0].jack_id == 2);
+	REQUIRE(pd.module_states.size() == 1);
+	CHECK(pd.module_states[0].data() == R"({"model": 3, "path": "C:\\samples"})");
+}
+
+TEST_CASE("Converting allocates nothing, however long the strings") {
+	std::string state(1 << 20, 'A');
+	std::string json = R"({"PatchData": {"vcvModuleStates": [{"module_id": 1, "data": ")" + state + R"("}]}})";
+
+	size_t yaml_size = 0;
+	JsonToYmlStream converter{[&](std::string_view piece) {
+		yaml_size += piece.size();
+		return true;
+	}};
+
+	bool ok = false;
+	auto counts = AllocCounter::count([&] { ok = converter.feed(json) && converter.finish(); });
+	CHECK(ok);
+	CHECK(counts.total_allocs() == 0);
+	CHECK(yaml_size > state.size());
+}
+
+TEST_CASE("Invalid JSON is rejected") {
+	for (std::string_view json : {"", "{", R"({"a" 1})", "[1,]", R"({"a": tru})", "[1 2]", R"({"a": 1}})", "[1] 2"}) {
+		CAPTURE(json);
+		bool ok = true;
+		convert(json, &ok);
+		CHECK_FALSE(ok);
+	}
+
+	bool ok = false;
+	convert(std::string(JsonToYmlStream::MaxDepth, '[') + std::string(JsonToYmlStream::MaxDepth, ']'), &ok);
+	CHECK(ok);
+	convert(std::string(JsonToYmlStream::MaxDepth + 1, '[') + std::string(JsonToYmlStream::MaxDepth + 1, ']'), &ok);
+	CHECK_FALSE(ok);
+}
+
+TEST_CASE("JSON can be read in pieces from a source") {
+	std::string json = R"({"list": [1, 2, 3], "name": "abc"})";
+	size_t pos = 0;
+
+	std::string yaml;
+	bool ok = json_to_yml_stream(
+		[&](std::span<char> buf) {
+			// Three bytes at a time
+			auto n = std::min<size_t>(3, json.size() - pos);
+			json.copy(buf.data(), n, pos);
+			pos += n;
+			return n;
+		},
+		[&](std::string_view piece) {
+			yaml += piece;
+			return true;
+		});
+
+	CHECK(ok);
+	CHECK(yaml == "list:\n  - 1\n  - 2\n  - 3\nname: abc\n");
+}
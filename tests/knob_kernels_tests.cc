@@ -0,0 +1,108 @@
+#include "doctest.h"
+#include "patch/knob_kernels.hh"
+#include "patch/knob_set_plan.hh"
+#include "patch_generator.hh"
+#include <algorithm>
+
+using namespace MetaModule;
+
+namespace
+{
+
+// Mappings as MappedKnobs, and the arrays the kernels take
+struct Mappings {
+	std::vector<MappedKnob> knobs;
+	std::vector<float> min;
+	std::vector<float> scale;
+	std::vector<float> inv_scale;
+	std::vector<float> panel_vals;
+
+	explicit Mappings(size_t n) {
+		for (size_t i = 0; i < n; i++) {
+			// Reversed ranges, empty ranges, and both curve types
+			float lo = float(i % 5) * 0.1f;
+			float hi = i % 7 == 3 ? lo : float(i % 9) * 0.25f - 1.f;
+			auto curve = uint8_t(i % 3 == 1 ? MappedKnob::Toggle : MappedKnob::Normal);
+			knobs.push_back({.curve_type = curve, .min = lo, .max = hi});
+
+			min.push_back(lo);
+			scale.push_back(hi - lo);
+			inv_scale.push_back(KnobMapping::inverse_scale(scale.back()));
+			panel_vals.push_back(float(i % 13) / 12.f);
+		}
+	}
+};
+
+} // namespace
+
+TEST_CASE("Knob mapping kernels match MappedKnob") {
+	// Sizes around the vector width, so the scalar tail runs too
+	for (size_t n : {0, 1, 3, 4, 5, 8, 13, 31, 76}) {
+		CAPTURE(n);
+		Mappings m{n};
+
+		std::vector<float> out(n);
+		KnobMapping::map_values(m.min.data(), m.scale.data(), m.panel_vals.data(), out.data(), n);
+
+		for (size_t i = 0; i < n; i++) {
+			CAPTURE(i);
+			CHECK(out[i] == doctest::Approx(m.knobs[i].get_mapped_val(m.panel_vals[i])));
+		}
+
+		std::vector<float> unmapped(n);
+		KnobMapping::unmap_values(m.min.data(), m.inv_scale.data(), out.data(), unmapped.data(), n);
+
+		for (size_t i = 0; i < n; i++) {
+			CAPTURE(i);
+			CHECK(unmapped[i] == doctest::Approx(m.knobs[i].unmap_val(out[i])).epsilon(1e-5));
+		}
+	}
+}
+
+TEST_CASE("Knob mapping kernels can work in place") {
+	Mappings m{21};
+
+	std::vector<float> expected(21);
+	KnobMapping::map_values(m.min.data(), m.scale.data(), m.panel_vals.data(), expected.data(), 21);
+
+	auto vals = m.panel_vals;
+	KnobMapping::map_values(m.min.data(), m.scale.data(), vals.data(), vals.data(), 21);
+	CHECK(vals == expected);
+}
+
+TEST_CASE("Knob set plan maps and unmaps whole sets like MappedKnob") {
+	auto pd = generate_patch({.num_knob_sets = 2, .mappings_per_set = 40});
+	KnobSetPlan plan{pd};
+
+	std::vector<float> panel_vals(MaxPanelKnobs);
+	for (size_t i = 0; i < panel_vals.size(); i++)
+		panel_vals[i] = float(i) / float(MaxPanelKnobs - 1);
+
+	for (unsigned set_id = 0; set_id < plan.num_sets(); set_id++) {
+		CAPTURE(set_id);
+		auto const &knobs = pd.knob_sets[set_id].set;
+		auto s = plan.set(set_id);
+
+		std::vector<float> mapped(s.size());
+		plan.map(set_id, panel_vals, mapped);
+
+		std::vector<float> unmapped(s.size());
+		plan.unmap(set_id, mapped, unmapped);
+
+		size_t i = 0;
+		plan.apply(set_id, panel_vals, [&](uint16_t module_id, uint16_t param_id, float val) {
+			CAPTURE(i);
+			auto knob = std::find_if(knobs.begin(), knobs.end(), [&](MappedKnob const &k) {
+				return k.module_id == module_id && k.param_id == param_id && k.panel_knob_id == s.panel_knob_id[i];
+			});
+			REQUIRE(knob != knobs.end());
+
+			auto expected = knob->get_mapped_val(panel_vals[knob->panel_knob_id]);
+			CHECK(val == expected);
+			CHECK(mapped[i] == doctest::Approx(expected));
+			CHECK(unmapped[i] == doctest::Approx(knob->unmap_val(mapped[i])).epsilon(1e-4));
+			i++;
+		});
+		CHECK(i == s.size());
+	}
+}
@@ -0,0 +1,157 @@
+#include "doctest.h"
+#include "patch/knob_set_plan.hh"
+#include "patch_generator.hh"
+#include <map>
+
+using namespace MetaModule;
+
+namespace
+{
+
+using ParamValues = std::map<std::pair<uint16_t, uint16_t>, float>;
+
+std::vector<float> panel_values() {
+	std::vector<float> vals(LastButton + 1);
+	for (size_t i = 0; i < vals.size(); i++)
+		vals[i] = float(i % 11) / 10.f;
+	return vals;
+}
+
+ParamValues apply(KnobSetPlan const &plan, unsigned set_id, std::span<const float> panel_vals) {
+	ParamValues vals;
+	plan.apply(set_id, panel_vals, [&](uint16_t module_id, uint16_t param_id, float val) {
+		vals[{module_id, param_id}] = val;
+	});
+	return vals;
+}
+
+PatchData make_switch_patch() {
+	PatchData pd;
+	pd.blank_patch("sets");
+	pd.add_module("Osc");
+	pd.add_module("Filter");
+
+	auto map = [](uint16_t knob, uint16_t module_id, uint16_t param_id, float min = 0, float max = 1) {
+		return MappedKnob{.panel_knob_id = knob, .module_id = module_id, .param_id = param_id, .min = min, .max = max};
+	};
+
+	pd.add_update_mapped_knob(0, map(0, 1, 0));
+	pd.add_update_mapped_knob(0, map(1, 1, 1));
+	pd.add_update_mapped_knob(0, map(2, 2, 0));
+	pd.add_update_mapped_knob(0, map(3, 2, 1));
+
+	// Same as set 0, except knob 1 has a new range, knob 3 moved to another param, and
+	// knob 5 is added
+	pd.add_update_mapped_knob(1, map(0, 1, 0));
+	pd.add_update_mapped_knob(1, map(1, 1, 1, 0.2f, 0.8f));
+	pd.add_update_mapped_knob(1, map(2, 2, 0));
+	pd.add_update_mapped_knob(1, map(3, 2, 2));
+	pd.add_update_mapped_knob(1, map(5, 1, 3));
+	return pd;
+}
+
+} // namespace
+
+TEST_CASE("Knob set plan maps like MappedKnob") {
+	auto pd = generate_patch({.num_knob_sets = 4, .mappings_per_set = 20});
+	KnobSetPlan plan{pd};
+	auto panel_vals = panel_values();
+
+	REQUIRE(plan.num_sets() == pd.knob_sets.size());
+
+	for (unsigned set_id = 0; set_id < plan.num_sets(); set_id++) {
+		CAPTURE(set_id);
+		auto const &knobs = pd.knob_sets[set_id].set;
+		auto s = plan.set(set_id);
+		REQUIRE(s.size() == knobs.size());
+		CHECK(std::is_sorted(s.panel_knob_id.begin(), s.panel_knob_id.end()));
+
+		size_t i = 0;
+		plan.apply(set_id, panel_vals, [&](uint16_t module_id, uint16_t param_id, float val) {
+			auto knob = std::find_if(knobs.begin(), knobs.end(), [&](auto const &k) {
+				return k.module_id == module_id && k.param_id == param_id && k.panel_knob_id == s.panel_knob_id[i];
+			});
+			REQUIRE(knob != knobs.end());
+
+			CHECK(val == knob->get_mapped_val(panel_vals[knob->panel_knob_id]));
+			i++;
+		});
+		CHECK(i == knobs.size());
+	}
+
+	CHECK(plan.set(plan.num_sets()).size() == 0);
+}
+
+TEST_CASE("Knob set plan lists what changes between sets") {
+	auto pd = make_switch_patch();
+	KnobSetPlan plan{pd};
+
+	auto d = plan.delta(0, 1);
+	REQUIRE(d.changed.size() == 3);
+	auto s1 = plan.set(1);
+	CHECK(s1.panel_knob_id[d.changed[0]] == 1);
+	CHECK(s1.panel_knob_id[d.changed[1]] == 3);
+	CHECK(s1.panel_knob_id[d.changed[2]] == 5);
+	REQUIRE(d.released.size() == 1);
+	CHECK(d.released[0] == KnobSetPlan::Param{2, 1});
+
+	d = plan.delta(1, 0);
+	CHECK(d.changed.size() == 2);
+	REQUIRE(d.released.size() == 2);
+	CHECK(d.released[0] == KnobSetPlan::Param{2, 2});
+	CHECK(d.released[1] == KnobSetPlan::Param{1, 3});
+
+	CHECK(plan.delta(0, 0).changed.empty());
+	CHECK(plan.delta(0, 0).released.empty());
+	CHECK(plan.delta(0, 2).changed.empty());
+}
+
+TEST_CASE("Knob set plan ignores curve types, like MappedKnob::get_mapped_val") {
+	auto pd = make_switch_patch();
+	pd.knob_sets.push_back(pd.knob_sets[0]);
+	for (auto &m : pd.knob_sets[2].set)
+		m.curve_type = MappedKnob::Toggle;
+
+	KnobSetPlan plan{pd};
+	CHECK(plan.delta(0, 2).changed.empty());
+	CHECK(plan.delta(0, 2).released.empty());
+
+	auto panel_vals = panel_values();
+	CHECK(apply(plan, 2, panel_vals) == apply(plan, 0, panel_vals));
+	for (auto const &m : pd.knob_sets[2].set)
+		CHECK(apply(plan, 2, panel_vals)[{m.module_id, m.param_id}] == m.get_mapped_val(panel_vals[m.panel_knob_id]));
+}
+
+TEST_CASE("Switching with a knob set delta gives the same params as applying the set") {
+	auto pd = generate_patch({.num_knob_sets = 4, .mappings_per_set = 16});
+
+	// Make the sets overlap, as they do when a set is made by copying another
+	for (unsigned set_id = 1; set_id < pd.knob_sets.size(); set_id++) {
+		for (size_t i = 0; i < pd.knob_sets[set_id].set.size(); i += 2)
+			pd.knob_sets[set_id].set[i] = pd.knob_sets[0].set[i];
+	}
+
+	KnobSetPlan plan{pd};
+	auto panel_vals = panel_values();
+
+	for (unsigned from = 0; from < plan.num_sets(); from++) {
+		for (unsigned to = 0; to < plan.num_sets(); to++) {
+			CAPTURE(from);
+			CAPTURE(to);
+
+			auto vals = apply(plan, from, panel_vals);
+			for (auto p : plan.delta(from, to).released)
+				vals.erase({p.module_id, p.param_id});
+
+			plan.apply_switch(from, to, panel_vals, [&](uint16_t module_id, uint16_t param_id, float val) {
+				vals[{module_id, param_id}] = val;
+			});
+
+			CHECK(vals == apply(plan, to, panel_vals));
+			if (from == to)
+				CHECK(plan.delta(from, to).changed.empty());
+			else
+				CHECK(plan.delta(from, to).changed.size() < plan.set(to).size());
+		}
+	}
+}
@@ -0,0 +1,152 @@
+#include "../base64.hh"
+#include "../lz.hh"
+#include "doctest.h"
+#include <string>
+#include <vector>
+
+using namespace MetaModule;
+
+static std::span<const uint8_t> as_bytes(std::string_view s) {
+	return {reinterpret_cast<const uint8_t *>(s.data()), s.size()};
+}
+
+static std::vector<uint8_t> random_bytes(size_t size, uint32_t seed) {
+	std::vector<uint8_t> v(size);
+	for (auto &b : v) {
+		seed = seed * 1664525 + 1013904223;
+		b = seed >> 24;
+	}
+	return v;
+}
+
+// Text with the kind of repetition a patch file has
+static std::string patch_like_text(unsigned num_records) {
+	std::string s = "PatchData:\n  static_knobs:\n";
+	for (unsigned i = 0; i < num_records; i++) {
+		s += "    - module_id: " + std::to_string(i / 8) + "\n";
+		s += "      param_id: " + std::to_string(i % 8) + "\n";
+		s += "      value: 0." + std::to_string((i * 7919) % 1000) + "\n";
+	}
+	return s;
+}
+
+static void check_round_trip(std::span<const uint8_t> raw, std::span<const uint8_t> dict = {}) {
+	auto frame = Lz::compress(raw, dict);
+	REQUIRE(Lz::is_frame(frame));
+	CHECK(frame.size() <= Lz::max_compressed_size(raw.size()));
+	CHECK(Lz::decompressed_size(frame) == raw.size());
+
+	auto decoded = Lz::decompress(frame, dict);
+	REQUIRE(decoded.has_value());
+	CHECK(std::equal(decoded->begin(), decoded->end(), raw.begin(), raw.end()));
+}
+
+TEST_CASE("Lz round trips data of all sizes") {
+	for (size_t size = 0; size < 300; size++) {
+		check_round_trip(random_bytes(size, size));
+		check_round_trip(as_bytes(patch_like_text(size / 10).substr(0, size)));
+		check_round_trip(std::vector<uint8_t>(size, 'a'));
+	}
+
+	// Long literal runs, long matches and offsets near the window size
+	auto big = random_bytes(70000, 1);
+	std::copy(big.begin(), big.begin() + 5000, big.begin() + 65000);
+	check_round_trip(big);
+	check_round_trip(std::vector<uint8_t>(100000, 0));
+}
+
+TEST_CASE("Lz compresses patch files well") {
+	auto text = patch_like_text(2000);
+	auto frame = Lz::compress(as_bytes(text));
+	CHECK(frame.size() * 4 < text.size());
+	check_round_trip(as_bytes(text));
+}
+
+TEST_CASE("Lz stores incompressible data") {
+	auto raw = random_bytes(1000, 3);
+	auto frame = Lz::compress(raw);
+	CHECK(frame.size() == Lz::HeaderSize + raw.size());
+	check_round_trip(raw);
+}
+
+TEST_CASE("Lz dictionary") {
+	auto dict_text = patch_like_text(50);
+	auto text = patch_like_text(60).substr(20);
+	auto dict = as_bytes(dict_text);
+
+	auto with_dict = Lz::compress(as_bytes(text), dict);
+	auto without_dict = Lz::compress(as_bytes(text));
+	CHECK(with_dict.size() < without_dict.size() / 2);
+	check_round_trip(as_bytes(text), dict);
+
+	// The dictionary is required, and must be the same one
+	CHECK_FALSE(Lz::decompress(with_dict).has_value());
+	auto other = patch_like_text(51);
+	CHECK_FALSE(Lz::decompress(with_dict, as_bytes(other)).has_value());
+}
+
+TEST_CASE("Lz rejects corrupt frames without overrunning buffers") {
+	auto text = patch_like_text(100);
+	auto frame = Lz::compress(as_bytes(text));
+
+	CHECK_FALSE(Lz::decompress(std::span{frame}.first(Lz::HeaderSize - 1)).has_value());
+
+	auto truncated = frame;
+	truncated.pop_back();
+	CHECK_FALSE(Lz::decompress(truncated).has_value());
+
+	std::vector<uint8_t> small(text.size() - 1);
+	CHECK_FALSE(Lz::decompress_into(frame, small).has_value());
+
+	// Random corruption must fail or produce output of the right size, never crash
+	uint32_t x = 5;
+	for (unsigned i = 0; i < 2000; i++) {
+		auto corrupt = frame;
+		for (unsigned n = 0; n < 3; n++) {
+			x = x * 1664525 + 1013904223;
+			auto pos = Lz::HeaderSize + (x >> 8) % (corrupt.size() - Lz::HeaderSize);
+			corrupt[pos] ^= uint8_t(1u << (x % 8));
+		}
+		std::vector<uint8_t> out(text.size());
+		auto n = Lz::decompress_into(corrupt, out);
+		if (n)
+			CHECK(*n == text.size());
+	}
+}
+
+TEST_CASE("Lz rejects sizes the frame can't produce before allocating") {
+	auto frame = Lz::compress(as_bytes(patch_like_text(100)));
+
+	// A header claiming 4 GiB must fail up front, not try to allocate it
+	auto huge = frame;
+	huge[5] = huge[6] = huge[7] = huge[8] = 0xFF;
+	CHECK_FALSE(Lz::decompressed_size(huge).has_value());
+	CHECK_FALSE(Lz::decompress(huge).has_value());
+	CHECK_FALSE(Lz::decompress_base64(Base64::encode(huge)).has_value());
+
+	std::vector<uint8_t> empty_frame(frame.begin(), frame.begin() + Lz::HeaderSize);
+	CHECK_FALSE(Lz::decompressed_size(empty_frame).has_value());
+
+	// A stored frame holds exactly its raw size
+	auto stored = Lz::compress(random_bytes(100, 9));
+	REQUIRE((stored[4] & 0x01) != 0);
+	CHECK(Lz::decompressed_size(stored) == 100u);
+	stored[5]++;
+	CHECK_FALSE(Lz::decompressed_size(stored).has_value());
+	stored[5] -= 2;
+	CHECK_FALSE(Lz::decompress(stored).has_value());
+
+	// The most compressible input is still within the bound
+	check_round_trip(std::vector<uint8_t>(1 << 20, 0));
+}
+
+TEST_CASE("Lz module state helpers") {
+	auto text = patch_like_text(40);
+	auto raw = as_bytes(text);
+	auto encoded = Lz::compress_to_base64(raw);
+	auto decoded = Lz::decompress_base64(encoded);
+	REQUIRE(decoded.has_value());
+	CHECK(std::equal(decoded->begin(), decoded->end(), raw.begin(), raw.end()));
+
+	CHECK_FALSE(Lz::decompress_base64("not a frame").has_value());
+}
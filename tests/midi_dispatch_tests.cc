@@ -0,0 +1,212 @@
+#include "doctest.h"
+#include "patch/midi_dispatch.hh"
+
+using namespace MetaModule;
+
+namespace
+{
+
+PatchData make_midi_patch() {
+	PatchData pd;
+	pd.blank_patch("midi");
+	pd.add_module("Osc");
+	pd.add_module("Filter");
+	return pd;
+}
+
+MappedKnob cc_map(unsigned cc, uint16_t module_id, uint16_t param_id, uint8_t chan = 0) {
+	return {.panel_knob_id = uint16_t(MidiCC0 + cc),
+			.module_id = module_id,
+			.param_id = param_id,
+			.midi_chan = chan,
+			.min = 0,
+			.max = 1};
+}
+
+struct Call {
+	uint16_t module_id;
+	uint16_t param_id;
+	uint16_t value;
+};
+
+std::vector<Call> dispatch_cc(MidiDispatchTable &table, unsigned chan, unsigned cc, uint8_t val) {
+	std::vector<Call> calls;
+	table.dispatch_cc(chan, cc, val, [&](auto const &t, uint16_t value) {
+		calls.push_back({t.module_id, t.param_id, value});
+	});
+	return calls;
+}
+
+void check_same_lists(MidiDispatchTable const &a, MidiDispatchTable const &b) {
+	auto same = [](auto x, auto y) {
+		return std::equal(x.begin(), x.end(), y.begin(), y.end(), [](auto const &s, auto const &t) {
+			return s.module_id == t.module_id && s.param_id == t.param_id && s.midi_chan == t.midi_chan &&
+				   s.min == t.min && s.max == t.max;
+		});
+	};
+
+	for (unsigned cc = 0; cc < NumMidiCCsPW; cc++) {
+		CAPTURE(cc);
+		CHECK(same(a.cc_targets(cc), b.cc_targets(cc)));
+	}
+	for (unsigned note = 0; note < NumMidiNotes; note++) {
+		CAPTURE(note);
+		CHECK(same(a.notegate_targets(note), b.notegate_targets(note)));
+	}
+}
+
+} // namespace
+
+TEST_CASE("MIDI dispatch fans a CC out to every map of it") {
+	auto pd = make_midi_patch();
+	pd.add_update_midi_map(cc_map(7, 1, 0));
+	pd.add_update_midi_map(cc_map(7, 2, 3));
+	pd.add_update_midi_map(cc_map(74, 2, 1));
+
+	MidiDispatchTable table{pd};
+
+	auto calls = dispatch_cc(table, 1, 7, 127);
+	REQUIRE(calls.size() == 2);
+	CHECK(calls[0].module_id == 1);
+	CHECK(calls[0].param_id == 0);
+	CHECK(calls[1].module_id == 2);
+	CHECK(calls[1].param_id == 3);
+	CHECK(calls[0].value == (127 << 7));
+
+	CHECK(dispatch_cc(table, 1, 74, 10).size() == 1);
+	CHECK(dispatch_cc(table, 1, 75, 10).empty());
+	CHECK(dispatch_cc(table, 1, 200, 10).empty());
+	CHECK(dispatch_cc(table, 0, 7, 10).empty());
+}
+
+TEST_CASE("MIDI dispatch filters by each map's channel") {
+	auto pd = make_midi_patch();
+	pd.add_update_midi_map(cc_map(1, 1, 0, 0));
+	pd.add_update_midi_map(cc_map(1, 1, 1, 3));
+	pd.add_update_midi_map(cc_map(1, 2, 0, 16));
+
+	MidiDispatchTable table{pd};
+
+	CHECK(dispatch_cc(table, 1, 1, 64).size() == 1);
+	CHECK(dispatch_cc(table, 3, 1, 64).size() == 2);
+	CHECK(dispatch_cc(table, 16, 1, 64).size() == 2);
+
+	auto calls = dispatch_cc(table, 3, 1, 64);
+	CHECK(calls[1].param_id == 1);
+}
+
+TEST_CASE("MIDI dispatch pairs MSB and LSB CCs into 14-bit values") {
+	auto pd = make_midi_patch();
+	pd.add_update_midi_map(cc_map(1, 1, 0));
+
+	MidiDispatchTable table{pd};
+	CHECK_FALSE(table.is_paired(1));
+	table.pair_cc(1);
+	CHECK(table.is_paired(1));
+
+	auto msb = dispatch_cc(table, 2, 1, 0x40);
+	REQUIRE(msb.size() == 1);
+	CHECK(msb[0].value == (0x40 << 7));
+
+	auto lsb = dispatch_cc(table, 2, 33, 0x15);
+	REQUIRE(lsb.size() == 1);
+	CHECK(lsb[0].param_id == 0);
+	CHECK(lsb[0].value == ((0x40 << 7) | 0x15));
+
+	// MSBs are kept per channel
+	lsb = dispatch_cc(table, 3, 33, 0x15);
+	REQUIRE(lsb.size() == 1);
+	CHECK(lsb[0].value == 0x15);
+
+	SUBCASE("An LSB CC that is mapped itself is not paired") {
+		table.add_update_midi_map(pd, cc_map(33, 2, 0));
+		CHECK_FALSE(table.is_paired(1));
+
+		lsb = dispatch_cc(table, 2, 33, 0x15);
+		REQUIRE(lsb.size() == 1);
+		CHECK(lsb[0].module_id == 2);
+		CHECK(lsb[0].value == (0x15 << 7));
+	}
+}
+
+TEST_CASE("MIDI dispatch leaves an unpaired MSB CC's maps alone on its LSB CC") {
+	auto pd = make_midi_patch();
+	pd.add_update_midi_map(cc_map(0, 1, 0));
+	pd.add_update_midi_map(cc_map(1, 1, 1));
+
+	MidiDispatchTable table{pd};
+	table.pair_cc(1);
+
+	CHECK(dispatch_cc(table, 1, 0, 0x40).size() == 1);
+
+	// e.g. a button sending CC 32 on a controller with faders on CCs 0-7
+	CHECK(dispatch_cc(table, 1, 32, 0x7F).empty());
+	CHECK(dispatch_cc(table, 1, 32, 0).empty());
+
+	// Unpairing a CC stops it too
+	CHECK(dispatch_cc(table, 1, 33, 0x15).size() == 1);
+	table.pair_cc(1, false);
+	CHECK_FALSE(table.is_paired(1));
+	CHECK(dispatch_cc(table, 1, 33, 0x15).empty());
+
+	// Pairing survives a rebuild
+	table.pair_cc(1);
+	table.build(pd);
+	CHECK(table.is_paired(1));
+}
+
+TEST_CASE("MIDI dispatch of pitch wheel and note gates") {
+	auto pd = make_midi_patch();
+	pd.midi_maps.set.push_back({.panel_knob_id = MidiPitchWheelJack, .module_id = 1, .param_id = 4, .max = 1});
+	pd.add_update_midi_map({.panel_knob_id = MidiGateNote0 + 60, .module_id = 2, .param_id = 5, .midi_chan = 10});
+
+	MidiDispatchTable table{pd};
+	CHECK(table.cc_targets(Midi::PitchBendCC).size() == 1);
+	CHECK(table.notegate_targets(60).size() == 1);
+
+	uint16_t bend = 0;
+	CHECK(table.dispatch_pitchwheel(5, 0x3FFF, [&](auto const &, uint16_t value) { bend = value; }) == 1);
+	CHECK(bend == 0x3FFF);
+
+	unsigned gates = 0;
+	auto gate = [&](auto const &t) {
+		CHECK(t.param_id == 5);
+		gates++;
+	};
+	CHECK(table.dispatch_notegate(9, 60, gate) == 0);
+	CHECK(table.dispatch_notegate(10, 60, gate) == 1);
+	CHECK(table.dispatch_notegate(10, 61, gate) == 0);
+	CHECK(gates == 1);
+}
+
+TEST_CASE("MIDI dispatch table updated incrementally matches a rebuilt one") {
+	auto pd = make_midi_patch();
+	MidiDispatchTable table{pd};
+
+	CHECK(table.add_update_midi_map(pd, cc_map(7, 1, 0)));
+	CHECK(table.add_update_midi_map(pd, cc_map(7, 1, 1, 2)));
+	CHECK(table.add_update_midi_map(pd, cc_map(8, 2, 0)));
+	CHECK(table.add_update_midi_map(pd, {.panel_knob_id = MidiGateNote0 + 3, .module_id = 2, .param_id = 1}));
+	check_same_lists(table, MidiDispatchTable{pd});
+
+	// Moving a map to another CC takes it off the old one
+	CHECK(table.add_update_midi_map(pd, cc_map(9, 1, 0)));
+	CHECK(table.cc_targets(7).size() == 1);
+	CHECK(table.cc_targets(9).size() == 1);
+	check_same_lists(table, MidiDispatchTable{pd});
+
+	// Changing a map in place keeps its position
+	CHECK(table.add_update_midi_map(pd, cc_map(7, 1, 1, 5)));
+	CHECK(table.cc_targets(7)[0].midi_chan == 5);
+	check_same_lists(table, MidiDispatchTable{pd});
+
+	CHECK(table.remove_midi_map(pd, cc_map(8, 2, 0)));
+	CHECK(table.cc_targets(8).empty());
+	check_same_lists(table, MidiDispatchTable{pd});
+
+	// Rejected updates leave the table alone
+	CHECK_FALSE(table.add_update_midi_map(pd, {.panel_knob_id = 3, .module_id = 1, .param_id = 0}));
+	CHECK_FALSE(table.add_update_midi_map(pd, cc_map(1, 9, 0)));
+	CHECK_FALSE(table.remove_midi_map(pd, cc_map(8, 2, 0)));
+	check_same_lists(table, MidiDispatchTable{pd});
+}
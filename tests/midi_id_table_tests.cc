@@ -0,0 +1,92 @@
+#include "doctest.h"
+#include "patch/midi_id_table.hh"
+
+using namespace MetaModule;
+
+namespace
+{
+
+constexpr bool matches_classifiers(uint32_t id) {
+	using namespace Midi;
+	auto info = id_info(id);
+
+	auto poly_cable = [&](uint8_t event, bool poly5_8) {
+		return info.poly_cable_event() == event && info.is_poly5_8_cable() == poly5_8;
+	};
+
+	return info.is_midi() == is_midi_panel_id(id) && info.channel(id) == midi_channel(id) &&
+		   info.polychan() == polychan(id) && info.is_poly_cable() == is_midi_poly_cable(id) &&
+		   info.is_poly5_8_cable() == is_midi_poly5_8_cable(id) &&
+		   info.poly_cable_event() == midi_poly_cable_event(id) &&
+		   (!info.is_poly_cable() || info.poly_cable_base() == (is_midi_poly5_8_cable(id) ? MidiPolyCableChanBase : 0)) &&
+		   info.note_pitch() == midi_note_pitch(id) && info.note_gate() == midi_note_gate(id) &&
+		   info.note_vel() == midi_note_vel(id) && info.note_aft() == midi_note_aft(id) &&
+		   info.note_retrig() == midi_note_retrig(id) && poly_cable(0, false) == midi_note_pitch_poly(id) &&
+		   poly_cable(1, false) == midi_note_gate_poly(id) && poly_cable(2, false) == midi_note_vel_poly(id) &&
+		   poly_cable(3, false) == midi_note_aft_poly(id) && poly_cable(4, false) == midi_note_retrig_poly(id) &&
+		   poly_cable(0, true) == midi_note_pitch_poly5_8(id) && poly_cable(1, true) == midi_note_gate_poly5_8(id) &&
+		   poly_cable(2, true) == midi_note_vel_poly5_8(id) && poly_cable(3, true) == midi_note_aft_poly5_8(id) &&
+		   poly_cable(4, true) == midi_note_retrig_poly5_8(id) && info.cc() == midi_cc(id) &&
+		   info.gate() == midi_gate(id) && info.clk() == midi_clk(id) && info.divclk() == midi_divclk(id) &&
+		   info.transport() == midi_transport(id);
+}
+
+// Ids lo to hi, without channel bits, with a channel, and with channel bits but no
+// channel flag
+constexpr bool ids_match(uint32_t lo, uint32_t hi) {
+	for (uint32_t id = lo; id < hi; id++) {
+		uint32_t chan_bits = (id % 16) << 12;
+		if (!matches_classifiers(id) || !matches_classifiers(id | 0x800 | chan_bits) ||
+			!matches_classifiers(id | chan_bits))
+			return false;
+	}
+	return true;
+}
+
+// One event type per assert, to stay within the compiler's constexpr limits
+static_assert(ids_match(0x000, 0x100));
+static_assert(ids_match(0x100, 0x200));
+static_assert(ids_match(0x200, 0x300));
+static_assert(ids_match(0x300, 0x400));
+static_assert(ids_match(0x400, 0x500));
+static_assert(ids_match(0x500, 0x600));
+static_assert(ids_match(0x600, 0x700));
+static_assert(ids_match(0x700, 0x800));
+
+} // namespace
+
+TEST_CASE("MIDI id table agrees with the classifiers") {
+	for (uint32_t id = 0; id < 0x10000; id++) {
+		CAPTURE(id);
+		CHECK(matches_classifiers(id));
+	}
+}
+
+TEST_CASE("MIDI id table descriptors") {
+	using namespace Midi;
+
+	auto note = id_info(set_midi_channel(MidiVel5Jack, 3));
+	CHECK(note.type() == EventType::Note);
+	CHECK(note.polychan() == 5);
+	CHECK(note.note_vel() == 4u);
+	CHECK_FALSE(note.note_gate());
+	CHECK(note.channel(set_midi_channel(MidiVel5Jack, 3)) == 3);
+
+	auto cable = id_info(MidiAftPoly5_8Jack);
+	CHECK(cable.is_poly_cable());
+	CHECK(cable.poly_cable_base() == MidiPolyCableChanBase);
+	CHECK(cable.poly_cable_event() == 3);
+	CHECK_FALSE(cable.polychan());
+
+	CHECK(id_info(MidiPitchWheelJack).cc() == PitchBendCC);
+	CHECK(id_info(MidiGateNote127).gate() == 127u);
+	CHECK(id_info(MidiClockJack).clock_div() == 0u);
+	CHECK(id_info(MidiClockDiv96Jack).clock_div() == 96u);
+	CHECK(id_info(MidiContinueJack).transport() == 2u);
+
+	auto clock = id_info(set_midi_channel(MidiClockDiv6Jack, 5));
+	CHECK(clock.channel(set_midi_channel(MidiClockDiv6Jack, 5)) == 0);
+
+	CHECK(id_info(12).type() == EventType::None);
+	CHECK_FALSE(id_info(12).is_midi());
+}
@@ -0,0 +1,123 @@
+#include "doctest.h"
+#include "patch/midi_router.hh"
+#include "patch_generator.hh"
+
+using namespace MetaModule;
+
+namespace
+{
+
+std::vector<Jack> sorted_jacks(MidiJackRouter::Route const &route) {
+	std::vector<Jack> jacks;
+	route.for_each([&](Jack const &j) { jacks.push_back(j); });
+	std::sort(jacks.begin(), jacks.end(), [](Jack a, Jack b) {
+		return a.module_id < b.module_id || (a.module_id == b.module_id && a.jack_id < b.jack_id);
+	});
+	return jacks;
+}
+
+// What decoding each mapped_ins entry per event finds
+std::vector<Jack> decoded_jacks(PatchData const &pd, uint16_t id, unsigned chan) {
+	std::vector<Jack> jacks;
+	for (auto const &map : pd.mapped_ins) {
+		if (!Midi::is_midi_panel_id(map.panel_jack_id) || Midi::strip_midi_channel(map.panel_jack_id) != id)
+			continue;
+		auto map_chan = Midi::midi_channel(map.panel_jack_id);
+		if (map_chan == 0 || map_chan == chan)
+			jacks.insert(jacks.end(), map.ins.begin(), map.ins.end());
+	}
+	MidiJackRouter::Route route{jacks, {}};
+	return sorted_jacks(route);
+}
+
+} // namespace
+
+TEST_CASE("MIDI router finds the jacks of each event type") {
+	PatchData pd;
+	pd.blank_patch("midi");
+	pd.add_mapped_injack(MidiMonoNoteJack, {1, 0});
+	pd.add_mapped_injack(MidiGate3Jack, {1, 1});
+	pd.add_mapped_injack(MidiGatePoly5_8Jack, {1, 2});
+	pd.add_mapped_injack(Midi::set_midi_channel(MidiCC0 + 74, 2), {2, 0});
+	pd.add_mapped_injack(MidiCC0 + 74, {2, 1});
+	pd.add_mapped_injack(MidiPitchWheelJack, {2, 2});
+	pd.add_mapped_injack(MidiGateNote0 + 36, {3, 0});
+	pd.add_mapped_injack(MidiClockDiv6Jack, {3, 1});
+	pd.add_mapped_injack(MidiStopJack, {3, 2});
+	pd.add_mapped_injack(4, {4, 0}); // not MIDI
+
+	MidiJackRouter router{pd};
+
+	CHECK(router.note_pitch(0, 5).size() == 1);
+	CHECK(router.note_pitch(1, 5).empty());
+	CHECK(router.note_gate(2, 1).size() == 1);
+	CHECK(router.poly_cable(1, true, 1).size() == 1);
+	CHECK(router.poly_cable(1, false, 1).empty());
+	CHECK(router.cc(Midi::PitchBendCC, 9).size() == 1);
+	CHECK(router.gate_note(36, 16).size() == 1);
+	CHECK(router.clock(6).size() == 1);
+	CHECK(router.clock(0).empty());
+	CHECK(router.transport(1).size() == 1);
+	CHECK(router.transport(0).empty());
+
+	auto cc = router.cc(74, 2);
+	REQUIRE(cc.omni.size() == 1);
+	REQUIRE(cc.channel.size() == 1);
+	CHECK(cc.omni[0] == Jack{2, 1});
+	CHECK(cc.channel[0] == Jack{2, 0});
+	CHECK(router.cc(74, 3).size() == 1);
+
+	// Out of range events
+	CHECK(router.note_pitch(8, 1).empty());
+	CHECK(router.cc(200, 1).empty());
+	CHECK(router.clock(97).empty());
+	CHECK(router.transport(3).empty());
+	CHECK(router.route(0xFFFF, 1).empty());
+
+	CHECK(std::ranges::equal(router.used_ids(),
+							 std::vector<uint16_t>{MidiMonoNoteJack,
+												   MidiGate3Jack,
+												   MidiGatePoly5_8Jack,
+												   MidiCC0 + 74,
+												   MidiPitchWheelJack,
+												   MidiGateNote0 + 36,
+												   MidiClockDiv6Jack,
+												   MidiStopJack}));
+}
+
+TEST_CASE("MIDI router matches decoding mapped_ins for every event") {
+	PatchData pd;
+	pd.blank_patch("midi");
+
+	uint32_t seed = 1;
+	auto next = [&] {
+		seed = seed * 1664525 + 1013904223;
+		return seed >> 8;
+	};
+
+	for (unsigned i = 0; i < 300; i++) {
+		auto id = MidiMonoNoteJack + next() % (LastMidiJack - MidiMonoNoteJack);
+		pd.add_mapped_injack(uint16_t(Midi::set_midi_channel(id, next() % 17)),
+							 {uint16_t(next() % 32), uint16_t(next() % 16)});
+	}
+
+	MidiJackRouter router{pd};
+
+	for (uint16_t id = 0; id < MidiJackRouter::NumIds; id++) {
+		for (unsigned chan = 1; chan <= 16; chan++) {
+			CAPTURE(id);
+			CAPTURE(chan);
+			CHECK(sorted_jacks(router.route(id, chan)) == decoded_jacks(pd, id, chan));
+		}
+	}
+
+	SUBCASE("Rebuilding from another patch replaces the routes") {
+		auto other = generate_patch({.seed = 7});
+		router.build(other);
+
+		for (uint16_t id = 0; id < MidiJackRouter::NumIds; id++) {
+			CAPTURE(id);
+			CHECK(sorted_jacks(router.route(id, 1)) == decoded_jacks(other, id, 1));
+		}
+	}
+}
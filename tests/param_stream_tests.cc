@@ -0,0 +1,144 @@
+#include "../param_stream.hh"
+#include "doctest.h"
+#include <array>
+
+using namespace MetaModule;
+
+TEST_CASE("Param stream round-trip of static knobs and mappings") {
+	std::array<uint8_t, 256> buffer;
+	ParamStreamWriter writer{buffer};
+
+	CHECK(writer.add_static_knob({3, 7, 0.25f}));
+	CHECK(writer.add_static_knob({3, 8, -1.5f}));
+	CHECK(writer.add_static_knob({1, 2, 0.75f}));
+	CHECK(writer.add_mapping(1,
+							 {.panel_knob_id = 5,
+							  .module_id = 2,
+							  .param_id = 4,
+							  .curve_type = MappedKnob::Toggle,
+							  .midi_chan = 3,
+							  .min = 0.1f,
+							  .max = 0.9f,
+							  .alias_name = "Cutoff"}));
+	CHECK(writer.remove_mapping(PatchData::MIDIKnobSet, 2, 6));
+
+	auto msg = writer.finish();
+	REQUIRE(msg.size() > 0);
+
+	ParamStreamReader reader{msg};
+	ParamStreamRecord rec;
+
+	REQUIRE(reader.next(rec));
+	CHECK(rec.type == ParamStreamRecord::Type::StaticKnob);
+	CHECK(rec.knob.module_id == 3);
+	CHECK(rec.knob.param_id == 7);
+	CHECK(rec.knob.value == 0.25f);
+
+	REQUIRE(reader.next(rec));
+	CHECK(rec.knob.module_id == 3);
+	CHECK(rec.knob.param_id == 8);
+	CHECK(rec.knob.value == -1.5f);
+
+	REQUIRE(reader.next(rec));
+	CHECK(rec.knob.module_id == 1);
+	CHECK(rec.knob.param_id == 2);
+	CHECK(rec.knob.value == 0.75f);
+
+	REQUIRE(reader.next(rec));
+	CHECK(rec.type == ParamStreamRecord::Type::Mapping);
+	CHECK(rec.set_id == 1);
+	CHECK(rec.map.panel_knob_id == 5);
+	CHECK(rec.map.module_id == 2);
+	CHECK(rec.map.param_id == 4);
+	CHECK(rec.map.curve_type == MappedKnob::Toggle);
+	CHECK(rec.map.midi_chan == 3);
+	CHECK(rec.map.min == 0.1f);
+	CHECK(rec.map.max == 0.9f);
+	CHECK(std::string_view{rec.map.alias_name.c_str()} == "Cutoff");
+
+	REQUIRE(reader.next(rec));
+	CHECK(rec.type == ParamStreamRecord::Type::Unmapping);
+	CHECK(rec.set_id == PatchData::MIDIKnobSet);
+	CHECK(rec.knob.module_id == 2);
+	CHECK(rec.knob.param_id == 6);
+
+	CHECK_FALSE(reader.next(rec));
+	CHECK_FALSE(reader.error());
+}
+
+TEST_CASE("Param stream records are compact") {
+	std::array<uint8_t, 64> buffer;
+	ParamStreamWriter writer{buffer};
+
+	writer.add_static_knob({12, 3, 0.5f});
+	auto after_first = writer.size();
+	writer.add_static_knob({12, 3, 0.6f});
+
+	// Same knob again: tag + two 1-byte deltas + 4-byte value
+	CHECK(writer.size() - after_first == 7);
+}
+
+TEST_CASE("Param stream writer rejects records that don't fit") {
+	std::array<uint8_t, 16> buffer;
+	ParamStreamWriter writer{buffer};
+
+	CHECK(writer.add_static_knob({1, 1, 1.f}));
+	CHECK_FALSE(writer.add_static_knob({2, 2, 2.f}));
+
+	auto msg = writer.finish();
+	REQUIRE(msg.size() > 0);
+
+	ParamStreamReader reader{msg};
+	ParamStreamRecord rec;
+	CHECK(reader.next(rec));
+	CHECK(rec.knob.value == 1.f);
+	CHECK_FALSE(reader.next(rec));
+	CHECK_FALSE(reader.error());
+}
+
+TEST_CASE("Param stream reader detects malformed messages") {
+	std::array<uint8_t, 64> buffer;
+	ParamStreamWriter writer{buffer};
+	writer.add_static_knob({1, 1, 1.f});
+	auto msg = writer.finish();
+
+	SUBCASE("Bad header") {
+		std::array<uint8_t, 3> bad{'X', 'S', 1};
+		ParamStreamReader reader{bad};
+		ParamStreamRecord rec;
+		CHECK_FALSE(reader.next(rec));
+		CHECK(reader.error());
+	}
+
+	SUBCASE("Truncated") {
+		ParamStreamReader reader{msg.subspan(0, msg.size() - 3)};
+		ParamStreamRecord rec;
+		CHECK_FALSE(reader.next(rec));
+		CHECK(reader.error());
+	}
+}
+
+TEST_CASE("Applying a param stream to a patch") {
+	PatchData pd;
+	pd.blank_patch("stream");
+	pd.add_module("Osc");
+	pd.add_module("Filter");
+	pd.static_knobs.push_back({1, 0, 0.f});
+
+	std::array<uint8_t, 128> buffer;
+	ParamStreamWriter writer{buffer};
+	writer.add_static_knob({1, 0, 0.33f});
+	writer.add_static_knob({2, 1, 0.66f});
+	writer.add_mapping(0, {.panel_knob_id = 0, .module_id = 2, .param_id = 1, .min = 0.f, .max = 1.f});
+
+	CHECK(apply_param_stream(writer.finish(), pd));
+
+	CHECK(pd.get_static_knob_value(1, 0) == 0.33f);
+	CHECK(pd.get_static_knob_value(2, 1) == 0.66f);
+	CHECK(pd.find_mapped_knob(0, 2, 1) != nullptr);
+
+	writer.reset();
+	writer.remove_mapping(0, 2, 1);
+	CHECK(apply_param_stream(writer.finish(), pd));
+	CHECK(pd.find_mapped_knob(0, 2, 1) == nullptr);
+}
@@ -0,0 +1,159 @@
+#include "../lz.hh"
+#include "../patch_bank.hh"
+#include "../patch_to_yaml.hh"
+#include "doctest.h"
+#include "patch/patch_hash.hh"
+#include "patch_generator.hh"
+#include <cstdio>
+#include <string>
+
+using namespace MetaModule;
+
+static std::span<const uint8_t> as_bytes(std::string_view s) {
+	return {reinterpret_cast<const uint8_t *>(s.data()), s.size()};
+}
+
+TEST_CASE("Patch bank index lookups") {
+	PatchBankWriter writer;
+	for (unsigned i = 0; i < 128; i++) {
+		auto name = "Patch " + std::to_string((i * 37) % 128);
+		CHECK(writer.add(name, "contents of " + name));
+	}
+	CHECK_FALSE(writer.add("Patch 5", "duplicate"));
+
+	auto bank = writer.build();
+
+	PatchBankReader reader;
+	REQUIRE(reader.open(bank));
+	CHECK(reader.size() == 128);
+
+	for (unsigned i = 0; i < 128; i++) {
+		auto name = "Patch " + std::to_string(i);
+		auto idx = reader.find(name);
+		REQUIRE(idx.has_value());
+
+		auto e = reader.entry(*idx);
+		CHECK(e.name == name);
+		CHECK(e.format == PatchBankFormat::Yaml);
+		CHECK(std::string_view{reinterpret_cast<const char *>(e.data.data()), e.data.size()} == "contents of " + name);
+		CHECK(reinterpret_cast<uintptr_t>(e.data.data()) % 8 == reinterpret_cast<uintptr_t>(bank.data()) % 8);
+		CHECK(reader.verify(*idx));
+	}
+
+	CHECK_FALSE(reader.find("Patch 128").has_value());
+	CHECK_FALSE(reader.find("").has_value());
+}
+
+TEST_CASE("Patch bank rejects malformed banks") {
+	PatchBankWriter writer;
+	writer.add("a", "aaaa");
+	writer.add("b", "bbbb");
+	auto bank = writer.build();
+
+	PatchBankReader reader;
+	CHECK_FALSE(reader.open(std::span{bank}.first(bank.size() - 1)));
+	CHECK_FALSE(reader.open(std::span{bank}.first(10)));
+
+	auto bad_magic = bank;
+	bad_magic[0] = 'X';
+	CHECK_FALSE(reader.open(bad_magic));
+	CHECK(reader.size() == 0);
+
+	// Data offset of the first entry pointing past the end
+	auto bad_offset = bank;
+	bad_offset[16 + 8] = 0xFF;
+	bad_offset[16 + 11] = 0xFF;
+	CHECK_FALSE(reader.open(bad_offset));
+
+	// Corrupt data is caught by verify()
+	auto bad_data = bank;
+	bad_data.back() ^= 1;
+	REQUIRE(reader.open(bad_data));
+	CHECK(reader.verify(0));
+	CHECK_FALSE(reader.verify(1));
+}
+
+TEST_CASE("Patches load from a bank") {
+	PatchBankWriter writer;
+	std::vector<uint64_t> hashes;
+	for (unsigned i = 0; i < 8; i++) {
+		auto pd = generate_patch({.seed = i, .num_modules = 20});
+		hashes.push_back(patch_hash(pd));
+		auto yaml = patch_to_yaml_string(pd);
+		if (i % 2)
+			writer.add("P" + std::to_string(i), yaml);
+		else
+			writer.add("P" + std::to_string(i), Lz::compress(as_bytes(yaml)), PatchBankFormat::LzYaml);
+	}
+	auto bank = writer.build();
+
+	PatchBankReader reader;
+	REQUIRE(reader.open(bank));
+
+	std::vector<char> scratch;
+	for (unsigned i = 0; i < 8; i++) {
+		auto idx = reader.find("P" + std::to_string(i));
+		REQUIRE(idx.has_value());
+		PatchData pd;
+		REQUIRE(reader.load(*idx, pd, scratch));
+		CHECK(patch_hash(pd) == hashes[i]);
+	}
+}
+
+TEST_CASE("Bank loads are bounded before allocating") {
+	auto yaml = patch_to_yaml_string(generate_patch({.num_modules = 20}));
+
+	PatchBankWriter writer;
+	writer.add("lz", Lz::compress(as_bytes(yaml)), PatchBankFormat::LzYaml);
+	writer.add("yaml", yaml);
+	auto bank = writer.build();
+
+	PatchBankReader reader;
+	REQUIRE(reader.open(bank));
+	std::vector<char> scratch;
+	PatchData pd;
+
+	PatchLoadOptions small{.limits = {.max_file_bytes = yaml.size() - 1}};
+	CHECK_FALSE(reader.load(0, pd, scratch, small));
+	CHECK_FALSE(reader.load(1, pd, scratch, small));
+	CHECK(scratch.empty());
+
+	PatchLoadOptions enough{.limits = {.max_file_bytes = yaml.size()}};
+	CHECK(reader.load(0, pd, scratch, enough));
+	CHECK(reader.load(1, pd, scratch, enough));
+
+	// A corrupt entry header claiming 4 GiB of yaml fails without allocating it
+	auto e = reader.entry(0);
+	auto corrupt = bank;
+	auto frame_pos = size_t(e.data.data() - bank.data());
+	for (size_t i = 5; i < 9; i++)
+		corrupt[frame_pos + i] = 0xFF;
+	REQUIRE(reader.open(corrupt));
+	scratch.clear();
+	CHECK_FALSE(reader.load(0, pd, scratch));
+	CHECK(scratch.empty());
+}
+
+#if __has_include(<sys/mman.h>)
+TEST_CASE("Patch bank can be memory mapped") {
+	PatchBankWriter writer;
+	writer.add("one", "1");
+	writer.add("two", "22");
+	auto bank = writer.build();
+
+	const char *path = "test_bank.mmpb";
+	auto f = fopen(path, "wb");
+	REQUIRE(f);
+	fwrite(bank.data(), 1, bank.size(), f);
+	fclose(f);
+
+	{
+		MappedPatchBank mapped;
+		REQUIRE(mapped.open(path));
+		auto idx = mapped.reader().find("two");
+		REQUIRE(idx.has_value());
+		CHECK(mapped.reader().entry(*idx).data.size() == 2);
+	}
+	remove(path);
+}
+#endif
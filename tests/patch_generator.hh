@@ -0,0 +1,249 @@
+#pragma once
+#include "base64.hh"
+#include "patch/patch_data.hh"
+#include <array>
+#include <string>
+
+namespace MetaModule
+{
+
+// Builds reproducible PatchData of any size, for scaling tests, benchmarks and fuzzing.
+// The same options and seed always produce the same patch, on every platform.
+struct PatchGeneratorOptions {
+	uint32_t seed = 1;
+	unsigned num_modules = 16; // including the hub
+
+	// Cables leave one output and fan out to 1..max_fanout inputs, with small fan-outs
+	// the most common. Roughly cables_per_module cables leave each module.
+	float cables_per_module = 1.5f;
+	unsigned max_fanout = 8;
+
+	unsigned knobs_per_module = 8;
+	unsigned num_knob_sets = 3;
+	unsigned mappings_per_set = 12;
+	unsigned num_midi_maps = 8;
+	unsigned num_mapped_ins = 6;
+	unsigned num_mapped_outs = 4;
+	unsigned num_lights = 4;
+
+	// Fraction of modules that get an alias, a state, or are bypassed
+	float alias_fraction = 0.1f;
+	float state_fraction = 0.25f;
+	float bypass_fraction = 0.05f;
+
+	// Size of each module's state before base64 encoding
+	size_t state_size = 256;
+};
+
+class PatchGenerator {
+public:
+	explicit PatchGenerator(PatchGeneratorOptions const &options)
+		: opts{options}
+		, rng_state{options.seed} {
+	}
+
+	PatchData generate() {
+		PatchData pd;
+		pd.blank_patch("Generated " + std::to_string(opts.seed));
+		pd.description.copy("Synthetic patch with " + std::to_string(opts.num_modules) + " modules");
+		pd.midi_poly_num_setting = below(9);
+		pd.midi_pitchwheel_range = float(1 + below(12));
+		pd.suggested_samplerate = 48000;
+		pd.suggested_blocksize = 64;
+
+		for (unsigned i = 1; i < opts.num_modules; i++)
+			pd.add_module(slugs[below(slugs.size())]);
+
+		if (num_modules() == 0)
+			return pd;
+
+		add_cables(pd);
+		add_static_knobs(pd);
+		add_knob_sets(pd);
+		add_midi_maps(pd);
+		add_panel_jacks(pd);
+		add_lights(pd);
+		add_module_properties(pd);
+		return pd;
+	}
+
+	// Uniform in [0, n)
+	uint32_t below(size_t n) {
+		return n ? uint32_t((uint64_t(next()) * n) >> 32) : 0;
+	}
+
+	// Uniform in [0, 1)
+	float unit() {
+		return float(next() >> 8) / float(1u << 24);
+	}
+
+	bool chance(float p) {
+		return unit() < p;
+	}
+
+private:
+	PatchGeneratorOptions opts;
+	uint64_t rng_state;
+
+	// A mix of brands and module sizes, with long slugs to exercise BrandModuleSlug
+	static constexpr std::array<const char *, 24> slugs{
+		"4msCompany:EnOsc",
+		"4msCompany:Djembe",
+		"4msCompany:StereoMixerV2",
+		"4msCompany:Seq8",
+		"4msCompany:MultiLFO",
+		"4msCompany:Verb",
+		"Befaco:EvenVCO",
+		"Befaco:Rampage",
+		"Befaco:ABC",
+		"Befaco:SpringReverb",
+		"AudibleInstruments:Braids",
+		"AudibleInstruments:Clouds",
+		"AudibleInstruments:Rings",
+		"AudibleInstruments:Warps",
+		"Fundamental:VCO",
+		"Fundamental:VCF",
+		"Fundamental:ADSR",
+		"Fundamental:SEQ3",
+		"HetrickCV:Boolean3",
+		"nonlinearcircuits:NeuronNLC",
+		"Valley:Plateau",
+		"Bogaudio:Bogaudio-AddrSeq",
+		"CountModula:CountModulaSequencer16",
+		"SurgeXTRack:SurgeXTOSCAlias",
+	};
+
+	// splitmix64
+	uint32_t next() {
+		uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return uint32_t((z ^ (z >> 31)) >> 32);
+	}
+
+	// Number of non-hub modules
+	unsigned num_modules() const {
+		return opts.num_modules > 1 ? opts.num_modules - 1 : 0;
+	}
+
+	uint16_t random_module() {
+		return uint16_t(1 + below(num_modules()));
+	}
+
+	Jack random_jack() {
+		return {random_module(), uint16_t(below(8))};
+	}
+
+	// Geometric: each extra input is half as likely as the previous
+	unsigned fanout() {
+		unsigned n = 1;
+		while (n < opts.max_fanout && chance(0.5f))
+			n++;
+		return n;
+	}
+
+	void add_cables(PatchData &pd) {
+		auto num_cables = unsigned(opts.cables_per_module * float(num_modules()));
+
+		for (unsigned i = 0; i < num_cables; i++) {
+			InternalCable cable;
+			// Mostly patch to a nearby module, as users build chains left to right
+			cable.out = {uint16_t(1 + i % num_modules()), uint16_t(below(8))};
+
+			for (unsigned n = fanout(); n > 0; n--) {
+				auto offset = chance(0.8f) ? 1 + below(4) : below(num_modules());
+				auto module_id = uint16_t(1 + (cable.out.module_id - 1 + offset) % num_modules());
+				cable.ins.push_back({module_id, uint16_t(below(8))});
+			}
+
+			if (chance(0.5f))
+				cable.color = uint16_t(below(0x10000));
+
+			pd.int_cables.push_back(std::move(cable));
+		}
+	}
+
+	void add_static_knobs(PatchData &pd) {
+		pd.static_knobs.reserve(num_modules() * opts.knobs_per_module);
+		for (uint16_t m = 1; m <= num_modules(); m++) {
+			for (uint16_t p = 0; p < opts.knobs_per_module; p++)
+				pd.static_knobs.push_back({m, p, unit()});
+		}
+	}
+
+	MappedKnob random_mapping(uint16_t panel_knob_id) {
+		MappedKnob map{};
+		map.panel_knob_id = panel_knob_id;
+		map.module_id = random_module();
+		map.param_id = uint16_t(below(opts.knobs_per_module ? opts.knobs_per_module : 1));
+		map.curve_type = chance(0.1f) ? MappedKnob::Toggle : MappedKnob::Normal;
+		map.min = chance(0.8f) ? 0.f : unit();
+		map.max = chance(0.8f) ? 1.f : unit();
+		if (chance(0.2f))
+			map.alias_name.copy("Knob " + std::to_string(panel_knob_id));
+		return map;
+	}
+
+	void add_knob_sets(PatchData &pd) {
+		for (unsigned set_id = 0; set_id < std::min(opts.num_knob_sets, MaxKnobSets); set_id++) {
+			for (unsigned i = 0; i < opts.mappings_per_set; i++)
+				pd.add_update_mapped_knob(set_id, random_mapping(uint16_t(i % MaxPanelKnobs)));
+			if (set_id < pd.knob_sets.size())
+				pd.knob_sets[set_id].name.copy("Set " + std::to_string(set_id + 1));
+		}
+	}
+
+	void add_midi_maps(PatchData &pd) {
+		for (unsigned i = 0; i < opts.num_midi_maps; i++) {
+			auto id = chance(0.8f) ? MidiCC0 + below(128) : MidiGateNote0 + below(128);
+			auto map = random_mapping(uint16_t(id));
+			map.midi_chan = uint8_t(below(17));
+			pd.add_update_midi_map(map);
+		}
+	}
+
+	void add_panel_jacks(PatchData &pd) {
+		for (unsigned i = 0; i < opts.num_mapped_ins; i++) {
+			// Mostly panel jacks, some MIDI jacks with a channel
+			uint32_t panel_jack_id = i;
+			if (chance(0.3f)) {
+				constexpr uint32_t midi_jacks[] = {MidiMonoNoteJack, MidiMonoGateJack, MidiCC0 + 1, MidiClockJack};
+				panel_jack_id = Midi::set_midi_channel(midi_jacks[below(4)], below(17));
+			}
+			for (unsigned n = fanout(); n > 0; n--)
+				pd.add_mapped_injack(panel_jack_id, random_jack());
+		}
+
+		for (unsigned i = 0; i < opts.num_mapped_outs; i++)
+			pd.add_mapped_outjack(i, random_jack());
+	}
+
+	void add_lights(PatchData &pd) {
+		for (unsigned i = 0; i < opts.num_lights; i++)
+			pd.mapped_lights.push_back({i, random_module(), uint16_t(below(16))});
+	}
+
+	void add_module_properties(PatchData &pd) {
+		std::vector<uint8_t> raw(opts.state_size);
+
+		for (uint16_t m = 1; m <= num_modules(); m++) {
+			if (chance(opts.alias_fraction))
+				pd.set_module_alias(m, "Voice " + std::to_string(m));
+
+			if (chance(opts.bypass_fraction))
+				pd.set_module_bypassed(m, true);
+
+			if (chance(opts.state_fraction)) {
+				for (auto &b : raw)
+					b = uint8_t(next());
+				pd.module_states.push_back({m, Base64::encode(raw)});
+			}
+		}
+	}
+};
+
+inline PatchData generate_patch(PatchGeneratorOptions const &options) {
+	return PatchGenerator{options}.generate();
+}
+
+} // namespace MetaModule
@@ -0,0 +1,52 @@
+#include "../patch_to_yaml.hh"
+#include "../yaml_to_patch.hh"
+#include "doctest.h"
+#include "patch/patch_hash.hh"
+#include "patch_generator.hh"
+
+using namespace MetaModule;
+
+TEST_CASE("Patch generator is deterministic") {
+	PatchGeneratorOptions opts{.seed = 42, .num_modules = 200};
+	CHECK(patch_hash(generate_patch(opts)) == patch_hash(generate_patch(opts)));
+
+	auto other = opts;
+	other.seed = 43;
+	CHECK(patch_hash(generate_patch(opts)) != patch_hash(generate_patch(other)));
+}
+
+TEST_CASE("Patch generator produces valid ids") {
+	for (unsigned num_modules : {1, 2, 10, 1000}) {
+		auto pd = generate_patch({.seed = num_modules, .num_modules = num_modules});
+		CHECK(pd.module_slugs.size() == num_modules);
+
+		auto valid = [&](uint32_t module_id) {
+			return module_id > 0 && module_id < num_modules;
+		};
+
+		for (auto const &cable : pd.int_cables) {
+			CHECK(valid(cable.out.module_id));
+			CHECK(cable.ins.size() > 0);
+			for (auto const &in : cable.ins)
+				CHECK(valid(in.module_id));
+		}
+		for (auto const &set : pd.knob_sets) {
+			for (auto const &map : set.set)
+				CHECK(valid(map.module_id));
+		}
+		for (auto const &state : pd.module_states)
+			CHECK(valid(state.module_id));
+	}
+}
+
+TEST_CASE("Generated patches survive a yaml round trip") {
+	auto pd = generate_patch({.seed = 7, .num_modules = 300, .state_size = 1000});
+	CHECK(pd.knob_sets.size() == 3);
+	CHECK(pd.midi_maps.set.size() > 0);
+	CHECK(pd.module_states.size() > 0);
+
+	auto yaml = patch_to_yaml_string(pd);
+	PatchData loaded;
+	REQUIRE(yaml_string_to_patch(yaml, loaded));
+	CHECK(patch_hash(loaded) == patch_hash(pd));
+}
@@ -0,0 +1,334 @@
+#include "doctest.h"
+#include "patch/patch_hash.hh"
+
+using namespace MetaModule;
+
+static PatchData make_hash_test_patch() {
+	PatchData pd;
+	pd.blank_patch("hash_test");
+	pd.add_module("Osc");
+	pd.add_module("Filter");
+	pd.add_module("VCA");
+
+	pd.add_internal_cable({2, 0}, {1, 0});
+	pd.add_internal_cable({3, 0}, {1, 0});
+	pd.add_internal_cable({3, 1}, {2, 0});
+	pd.add_mapped_injack(1, {1, 2});
+	pd.add_mapped_outjack(2, {3, 0});
+	pd.static_knobs.push_back({1, 0, 0.5f});
+	pd.static_knobs.push_back({2, 1, 0.25f});
+	pd.add_update_mapped_knob(0, {.panel_knob_id = 0, .module_id = 1, .param_id = 0, .min = 0, .max = 1});
+	pd.add_update_mapped_knob(0, {.panel_knob_id = 1, .module_id = 2, .param_id = 1, .min = 0, .max = 0.5f});
+	pd.mapped_lights.push_back({10, 1, 2});
+	pd.module_states.push_back({2, "state"});
+	pd.set_module_alias(1, "Lead");
+	pd.set_module_bypassed(3, true);
+	return pd;
+}
+
+TEST_CASE("Patch hash is stable for equal patches") {
+	auto a = make_hash_test_patch();
+	auto b = make_hash_test_patch();
+	CHECK(patch_hash(a) == patch_hash(b));
+}
+
+TEST_CASE("Patch hash ignores ordering where it has no meaning") {
+	auto a = make_hash_test_patch();
+	auto b = make_hash_test_patch();
+
+	std::swap(b.static_knobs[0], b.static_knobs[1]);
+	std::swap(b.int_cables[0], b.int_cables[1]);
+	std::swap(b.int_cables[1].ins[0], b.int_cables[1].ins[1]);
+	std::swap(b.knob_sets[0].set[0], b.knob_sets[0].set[1]);
+
+	CHECK(patch_hash(a) == patch_hash(b));
+}
+
+TEST_CASE("Patch hash detects changes") {
+	auto a = make_hash_test_patch();
+	auto h = patch_hash(a);
+
+	SUBCASE("static knob value") {
+		a.set_or_add_static_knob_value(1, 0, 0.51f);
+	}
+	SUBCASE("cable") {
+		a.disconnect_injack({3, 0});
+	}
+	SUBCASE("mapping range") {
+		a.add_update_mapped_knob(0, {.panel_knob_id = 0, .module_id = 1, .param_id = 0, .min = 0, .max = 0.9f});
+	}
+	SUBCASE("mapping moved to another knob set") {
+		auto map = a.knob_sets[0].set[0];
+		a.remove_mapping(0, map);
+		a.add_update_mapped_knob(1, map);
+	}
+	SUBCASE("module state") {
+		a.module_states[0].state_data = "stale";
+	}
+	SUBCASE("patch name") {
+		a.patch_name = "renamed";
+	}
+	SUBCASE("module order") {
+		std::swap(a.module_slugs[1], a.module_slugs[2]);
+	}
+
+	CHECK(patch_hash(a) != h);
+}
+
+TEST_CASE("Incremental patch hash updates match a full rehash") {
+	auto pd = make_hash_test_patch();
+	PatchHasher hasher{pd};
+
+	auto old_knob = *pd.find_static_knob(2, 1);
+	pd.set_or_add_static_knob_value(2, 1, 0.75f);
+	hasher.remove(old_knob);
+	hasher.add(*pd.find_static_knob(2, 1));
+
+	MappedKnob map{.panel_knob_id = 3, .module_id = 3, .param_id = 0, .min = 0, .max = 1};
+	pd.add_update_midi_map({.panel_knob_id = MidiCC0 + 7, .module_id = 3, .param_id = 0, .min = 0, .max = 1});
+	hasher.add_mapping(PatchData::MIDIKnobSet, pd.midi_maps.set.back());
+	pd.add_update_mapped_knob(0, map);
+	hasher.add_mapping(0, map);
+
+	pd.set_module_bypassed(3, false);
+	hasher.remove_bypassed(3);
+
+	pd.patch_name = "edited";
+	hasher.update_metadata(pd);
+
+	CHECK(hasher.value() == patch_hash(pd));
+}
+
+TEST_CASE("Patch hash covers knob sets past MaxKnobSets") {
+	// Files can hold more knob sets than the editor creates
+	auto a = make_hash_test_patch();
+	a.knob_sets.resize(MaxKnobSets + 2);
+	a.knob_sets.back().name = "Last";
+	a.knob_sets.back().set.push_back({.panel_knob_id = 2, .module_id = 3, .param_id = 1, .min = 0, .max = 1});
+	auto b = a;
+
+	SUBCASE("mapping") {
+		b.knob_sets.back().set[0].max = 0.5f;
+	}
+	SUBCASE("name") {
+		b.knob_sets.back().name = "Renamed";
+	}
+	SUBCASE("number of sets") {
+		b.knob_sets.push_back({});
+	}
+
+	CHECK(patch_hash(a) != patch_hash(b));
+
+	PatchHasher hasher{b};
+	hasher.remove_mapping(MaxKnobSets + 1, b.knob_sets[MaxKnobSets + 1].set[0]);
+	b.knob_sets[MaxKnobSets + 1].set.clear();
+	CHECK(hasher.value() == patch_hash(b));
+}
+
+// Mirrors an edit of a whole section on the hasher: removes what it held, adds what it holds now
+template<typename T>
+static void mirror_section(PatchHasher &hasher, std::vector<T> const &before, std::vector<T> const &after) {
+	for (auto const &x : before)
+		hasher.remove(x);
+	for (auto const &x : after)
+		hasher.add(x);
+}
+
+static void mirror_knob_sets(PatchHasher &hasher, PatchData const &before, PatchData const &after) {
+	for (unsigned set_id = 0; set_id < before.knob_sets.size(); set_id++) {
+		for (auto const &m : before.knob_sets[set_id].set)
+			hasher.remove_mapping(set_id, m);
+	}
+	for (auto const &m : before.midi_maps.set)
+		hasher.remove_mapping(PatchData::MIDIKnobSet, m);
+
+	hasher.update_knob_set_names(after);
+	for (unsigned set_id = 0; set_id < after.knob_sets.size(); set_id++) {
+		for (auto const &m : after.knob_sets[set_id].set)
+			hasher.add_mapping(set_id, m);
+	}
+	for (auto const &m : after.midi_maps.set)
+		hasher.add_mapping(PatchData::MIDIKnobSet, m);
+}
+
+// For mutators that can touch any section
+static void mirror_all(PatchHasher &hasher, PatchData const &before, PatchData const &after) {
+	hasher.update_metadata(after);
+	hasher.update_module_slugs(after);
+	mirror_section(hasher, before.int_cables, after.int_cables);
+	mirror_section(hasher, before.mapped_ins, after.mapped_ins);
+	mirror_section(hasher, before.mapped_outs, after.mapped_outs);
+	mirror_section(hasher, before.static_knobs, after.static_knobs);
+	mirror_section(hasher, before.mapped_lights, after.mapped_lights);
+	mirror_section(hasher, before.module_states, after.module_states);
+	mirror_section(hasher, before.module_aliases, after.module_aliases);
+	for (auto id : before.bypassed_modules)
+		hasher.remove_bypassed(id);
+	for (auto id : after.bypassed_modules)
+		hasher.add_bypassed(id);
+	mirror_knob_sets(hasher, before, after);
+}
+
+TEST_CASE("Each PatchData mutator can be mirrored on a PatchHasher") {
+	auto pd = make_hash_test_patch();
+	pd.add_update_midi_map({.panel_knob_id = MidiCC0 + 7, .module_id = 3, .param_id = 0, .min = 0, .max = 1});
+	pd.add_update_mapped_knob(1, {.panel_knob_id = 4, .module_id = 2, .param_id = 3, .min = 0, .max = 1});
+
+	PatchHasher hasher{pd};
+	auto initial = hasher.value();
+	REQUIRE(initial == patch_hash(pd));
+	auto before = pd;
+
+	SUBCASE("set_or_add_static_knob_value, existing knob") {
+		auto old_knob = *pd.find_static_knob(1, 0);
+		pd.set_or_add_static_knob_value(1, 0, 0.9f);
+		hasher.remove(old_knob);
+		hasher.add(*pd.find_static_knob(1, 0));
+	}
+	SUBCASE("set_or_add_static_knob_value, new knob") {
+		pd.set_or_add_static_knob_value(3, 2, 0.1f);
+		hasher.add(*pd.find_static_knob(3, 2));
+	}
+	SUBCASE("add_internal_cable to an existing output") {
+		auto old_cable = *pd.find_internal_cable_with_outjack({1, 0});
+		pd.add_internal_cable({3, 2}, {1, 0});
+		hasher.remove(old_cable);
+		hasher.add(*pd.find_internal_cable_with_outjack({1, 0}));
+	}
+	SUBCASE("add_internal_cable from a new output") {
+		pd.add_internal_cable({1, 1}, {3, 3});
+		hasher.add(pd.int_cables.back());
+	}
+	SUBCASE("disconnect_injack") {
+		pd.disconnect_injack({3, 0});
+		mirror_section(hasher, before.int_cables, pd.int_cables);
+		mirror_section(hasher, before.mapped_ins, pd.mapped_ins);
+		hasher.update_metadata(pd);
+	}
+	SUBCASE("disconnect_outjack") {
+		pd.disconnect_outjack({1, 0});
+		mirror_section(hasher, before.int_cables, pd.int_cables);
+		mirror_section(hasher, before.mapped_outs, pd.mapped_outs);
+	}
+	SUBCASE("remove_injack_mappings") {
+		pd.remove_injack_mappings({1, 2});
+		mirror_section(hasher, before.mapped_ins, pd.mapped_ins);
+		hasher.update_metadata(pd);
+	}
+	SUBCASE("remove_outjack_mappings") {
+		pd.remove_outjack_mappings({3, 0});
+		mirror_section(hasher, before.mapped_outs, pd.mapped_outs);
+	}
+	SUBCASE("add_mapped_injack to an existing panel jack") {
+		auto old_map = *pd.find_mapped_injack(uint16_t{1});
+		pd.add_mapped_injack(1, {2, 2});
+		hasher.remove(old_map);
+		hasher.add(*pd.find_mapped_injack(uint16_t{1}));
+		hasher.update_metadata(pd);
+	}
+	SUBCASE("add_mapped_injack to a new MIDI panel jack") {
+		pd.add_mapped_injack(MidiMonoNoteJack, {2, 3});
+		hasher.add(pd.mapped_ins.back());
+		hasher.update_metadata(pd);
+	}
+	SUBCASE("add_mapped_outjack") {
+		pd.add_mapped_outjack(5, {2, 1});
+		hasher.add(pd.mapped_outs.back());
+	}
+	SUBCASE("set_panel_in_alias") {
+		auto old_map = *pd.find_mapped_injack(uint16_t{1});
+		pd.set_panel_in_alias(1, "In");
+		hasher.remove(old_map);
+		hasher.add(*pd.find_mapped_injack(uint16_t{1}));
+	}
+	SUBCASE("set_panel_out_alias") {
+		auto old_map = *pd.find_mapped_outjack(uint16_t{2});
+		pd.set_panel_out_alias(2, "Out");
+		hasher.remove(old_map);
+		hasher.add(*pd.find_mapped_outjack(uint16_t{2}));
+	}
+	SUBCASE("add_update_mapped_knob, existing mapping") {
+		auto old_map = pd.knob_sets[0].set[0];
+		auto map = old_map;
+		map.max = 0.25f;
+		pd.add_update_mapped_knob(0, map);
+		hasher.remove_mapping(0, old_map);
+		hasher.add_mapping(0, map);
+	}
+	SUBCASE("add_update_mapped_knob, new knob set") {
+		MappedKnob map{.panel_knob_id = 5, .module_id = 1, .param_id = 4, .min = 0, .max = 1};
+		pd.add_update_mapped_knob(2, map);
+		hasher.update_knob_set_names(pd);
+		hasher.add_mapping(2, map);
+	}
+	SUBCASE("add_update_midi_map") {
+		auto old_map = pd.midi_maps.set[0];
+		auto map = old_map;
+		map.midi_chan = 3;
+		pd.add_update_midi_map(map);
+		hasher.remove_mapping(PatchData::MIDIKnobSet, old_map);
+		hasher.add_mapping(PatchData::MIDIKnobSet, map);
+	}
+	SUBCASE("remove_mapping") {
+		auto old_map = pd.knob_sets[1].set[0];
+		pd.remove_mapping(1, old_map);
+		hasher.remove_mapping(1, old_map);
+	}
+	SUBCASE("remove_mapping, MIDI") {
+		auto old_map = pd.midi_maps.set[0];
+		pd.remove_mapping(PatchData::MIDIKnobSet, old_map);
+		hasher.remove_mapping(PatchData::MIDIKnobSet, old_map);
+	}
+	SUBCASE("trim_empty_knobsets") {
+		pd.knob_sets.insert(pd.knob_sets.begin() + 1, MappedKnobSet{});
+		hasher.reset(pd);
+		initial = hasher.value();
+		before = pd;
+
+		pd.trim_empty_knobsets();
+		mirror_knob_sets(hasher, before, pd);
+	}
+	SUBCASE("set_module_bypassed") {
+		pd.set_module_bypassed(3, false);
+		pd.set_module_bypassed(2, true);
+		hasher.remove_bypassed(3);
+		hasher.add_bypassed(2);
+	}
+	SUBCASE("set_module_alias, rename") {
+		auto old_alias = pd.module_aliases[0];
+		pd.set_module_alias(1, "Bass");
+		hasher.remove(old_alias);
+		hasher.add(pd.module_aliases[0]);
+	}
+	SUBCASE("set_module_alias, new and cleared") {
+		auto old_alias = pd.module_aliases[0];
+		pd.set_module_alias(2, "Sweep");
+		pd.set_module_alias(1, "");
+		hasher.remove(old_alias);
+		hasher.add(pd.module_aliases.back());
+	}
+	SUBCASE("add_module") {
+		pd.add_module("Env");
+		hasher.update_module_slugs(pd);
+	}
+	SUBCASE("remove_module") {
+		pd.remove_module(2);
+		mirror_all(hasher, before, pd);
+	}
+	SUBCASE("blank_out_module") {
+		pd.blank_out_module(1);
+		mirror_all(hasher, before, pd);
+	}
+	SUBCASE("update_midi_poly_num") {
+		pd.midi_poly_num_setting = 4;
+		pd.update_midi_poly_num();
+		hasher.update_metadata(pd);
+	}
+	SUBCASE("blank_patch") {
+		pd.blank_patch("blank");
+		mirror_all(hasher, before, pd);
+	}
+
+	CHECK(hasher.value() != initial);
+	CHECK(hasher.value() == patch_hash(pd));
+}
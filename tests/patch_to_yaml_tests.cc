@@ -1,7 +1,10 @@
 #include "../patch_to_yaml.hh"
 #include "../yaml_to_patch.hh"
 #include "doctest.h"
+#include "patch/patch_hash.hh"
+#include "patch_generator.hh"
 #include "ryml_serial.hh"
+#include <cstring>
 #include <iostream>
 #include <vector>
 
@@ -315,3 +318,171 @@ TEST_CASE("set_module_alias clear with empty string") {
 	CHECK(pd.get_module_alias(1).empty());
 	CHECK(pd.module_aliases.empty());
 }
+
+TEST_CASE("Float values round-trip exactly and use the shortest form") {
+	MetaModule::PatchData pd{
+		.module_slugs{"HubMedium", "VCO"},
+	};
+	pd.patch_name = "floats";
+
+	std::vector<float> values{0.1f, 0.123456789f, 1.f / 3.f, -0.f, 1e-7f, 3.4028235e38f, 1.4e-45f, 16777217.f, -2.5f};
+	for (uint16_t i = 0; auto v : values)
+		pd.static_knobs.push_back({1, i++, v});
+	pd.midi_pitchwheel_range = 2.f / 3.f;
+
+	auto yaml = patch_to_yaml_string(pd);
+	CHECK(yaml.find("value: 0.1\n") != std::string::npos);
+	CHECK(yaml.find("value: 0.12345679\n") != std::string::npos);
+	CHECK(yaml.find("value: -2.5\n") != std::string::npos);
+
+	MetaModule::PatchData pd2;
+	REQUIRE(yaml_string_to_patch(yaml, pd2));
+	REQUIRE(pd2.static_knobs.size() == values.size());
+	for (size_t i = 0; i < values.size(); i++) {
+		CHECK(std::memcmp(&pd2.static_knobs[i].value, &values[i], sizeof(float)) == 0);
+	}
+	CHECK(pd2.midi_pitchwheel_range == pd.midi_pitchwheel_range);
+}
+
+TEST_CASE("Compact yaml is smaller and reads back the same") {
+	auto pd = MetaModule::generate_patch({.seed = 11, .num_modules = 200, .state_fraction = 0});
+
+	auto block = MetaModule::patch_to_yaml_string(pd);
+	auto compact = MetaModule::patch_to_yaml_string(pd, {.compact = true});
+	CHECK(compact.size() * 2 < block.size());
+	CHECK(compact.find("out: [") != std::string::npos);
+
+	MetaModule::PatchData from_block;
+	MetaModule::PatchData from_compact;
+	REQUIRE(MetaModule::yaml_string_to_patch(block, from_block));
+	REQUIRE(MetaModule::yaml_string_to_patch(compact, from_compact));
+	CHECK(MetaModule::patch_hash(from_compact) == MetaModule::patch_hash(from_block));
+	CHECK(MetaModule::patch_hash(from_compact) == MetaModule::patch_hash(pd));
+
+	// Aliases keep their records in block style
+	pd.set_panel_in_alias(pd.mapped_ins[0].panel_jack_id, "Pitch, [CV]");
+	compact = MetaModule::patch_to_yaml_string(pd, {.compact = true});
+	REQUIRE(MetaModule::yaml_string_to_patch(compact, from_compact));
+	CHECK(std::string_view{from_compact.mapped_ins[0].alias_name} == "Pitch, [CV]");
+}
+
+TEST_CASE("Resumable emitter writes a snapshot of the patch in pieces") {
+	using enum MetaModule::ResumablePatchEmitter::Status;
+
+	auto pd = MetaModule::generate_patch({.seed = 12, .num_modules = 100});
+
+	for (bool compact : {false, true}) {
+		CAPTURE(compact);
+		auto expected = MetaModule::patch_to_yaml_string(pd, {.compact = compact});
+
+		std::string out;
+		unsigned num_pieces = 0;
+		auto sink = [&](std::string_view piece) {
+			out += piece;
+			num_pieces++;
+			return true;
+		};
+
+		auto edited = pd;
+		MetaModule::ResumablePatchEmitter emitter{edited, sink, {.compact = compact}, 1024};
+
+		// Edits between steps don't reach the output
+		unsigned num_steps = 0;
+		while (emitter.step() == InProgress) {
+			if (edited.module_slugs.size() > 1)
+				edited.remove_module(edited.module_slugs.size() - 1);
+			edited.patch_name.copy("Edited");
+			num_steps++;
+		}
+
+		CHECK(emitter.status() == Done);
+		CHECK(emitter.bytes_written() == expected.size());
+		CHECK(out == expected);
+		CHECK(num_pieces == num_steps + 1);
+		CHECK(num_pieces > expected.size() / 4096);
+
+		// At least 16kB per step
+		std::string budget_out;
+		auto budget_sink = [&](std::string_view piece) {
+			budget_out += piece;
+			return true;
+		};
+		MetaModule::ResumablePatchEmitter budget_emitter{pd, budget_sink, {.compact = compact}, 1024};
+		unsigned num_budget_steps = 0;
+		while (budget_emitter.step(16 * 1024) == InProgress)
+			num_budget_steps++;
+		CHECK(budget_out == expected);
+		CHECK(num_budget_steps < num_steps);
+	}
+}
+
+TEST_CASE("Resumable emitter stops when the sink fails") {
+	auto pd = MetaModule::generate_patch({.seed = 13, .num_modules = 50});
+
+	unsigned num_pieces = 0;
+	MetaModule::ResumablePatchEmitter emitter{pd, [&](std::string_view) { return ++num_pieces < 3; }, {}, 256};
+
+	while (emitter.step() == MetaModule::ResumablePatchEmitter::Status::InProgress) {
+	}
+	CHECK(emitter.status() == MetaModule::ResumablePatchEmitter::Status::Failed);
+	CHECK(num_pieces == 3);
+}
+
+TEST_CASE("Patches round trip through JSON") {
+	auto pd = MetaModule::generate_patch({.seed = 14, .num_modules = 60});
+
+	for (bool compact : {false, true}) {
+		CAPTURE(compact);
+		auto json = MetaModule::patch_to_json_string(pd, {.compact = compact});
+		CHECK(json.starts_with("{"));
+		CHECK(json.find("\"PatchData\"") != std::string::npos);
+
+		// The parser works in place
+		auto json_copy = json;
+		MetaModule::PatchData from_json;
+		REQUIRE(MetaModule::json_to_patch(json_copy, from_json));
+		CHECK(MetaModule::patch_hash(from_json) == MetaModule::patch_hash(pd));
+
+		// The buffer version writes the same
+		std::vector<char> out(json.size() * 2);
+		std::span<char> buffer{out};
+		CHECK(MetaModule::patch_to_json_buffer(pd, buffer, {.compact = compact}) == json.size());
+		CHECK(std::string_view{buffer.data(), buffer.size()} == json);
+
+		// And it reads the same as yaml converted from the JSON
+		MetaModule::PatchData from_yaml;
+		REQUIRE(MetaModule::yaml_string_to_patch(MetaModule::json_to_yml(json), from_yaml));
+		CHECK(MetaModule::patch_hash(from_yaml) == MetaModule::patch_hash(pd));
+	}
+}
+
+TEST_CASE("Names that look like numbers or booleans stay strings in JSON") {
+	auto pd = MetaModule::generate_patch({.seed = 15, .num_modules = 10});
+	pd.patch_name = "123";
+	pd.description = "true";
+	pd.set_module_alias(1, "null");
+	pd.knob_sets[0].name = "false";
+	pd.knob_sets[0].set[0].alias_name = "1.5";
+	pd.module_slugs[2] = "007";
+
+	for (bool compact : {false, true}) {
+		CAPTURE(compact);
+		auto json = MetaModule::patch_to_json_string(pd, {.compact = compact});
+		CHECK(json.find("\"patch_name\": \"123\"") != std::string::npos);
+		CHECK(json.find("\"description\": \"true\"") != std::string::npos);
+		CHECK(json.find("\"alias_name\": \"null\"") != std::string::npos);
+		CHECK(json.find("\"name\": \"false\"") != std::string::npos);
+		CHECK(json.find("\"alias_name\": \"1.5\"") != std::string::npos);
+		CHECK(json.find("\"2\": \"007\"") != std::string::npos);
+
+		MetaModule::PatchData from_json;
+		REQUIRE(MetaModule::json_to_patch(json, from_json));
+		CHECK(from_json.patch_name.is_equal("123"));
+		CHECK(from_json.description.is_equal("true"));
+		CHECK(from_json.get_module_alias(1) == "null");
+		CHECK(from_json.knob_sets[0].name.is_equal("false"));
+		CHECK(from_json.knob_sets[0].set[0].alias_name.is_equal("1.5"));
+		CHECK(from_json.module_slugs[2].is_equal("007"));
+		CHECK(MetaModule::patch_hash(from_json) == MetaModule::patch_hash(pd));
+	}
+}
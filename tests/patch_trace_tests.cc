@@ -0,0 +1,132 @@
+#include "../patch_to_yaml.hh"
+#include "../patch_trace.hh"
+#include "../yaml_to_patch.hh"
+#include "doctest.h"
+#include "patch_generator.hh"
+#include <algorithm>
+#include <string_view>
+#include <thread>
+
+using namespace MetaModule;
+
+TEST_CASE("Chrome trace json") {
+	ChromeTraceWriter trace;
+	trace.add({"load", "parse", 2'000'000, 1500, 100, 7});
+	trace.add({"load", "int_cables", 2'001'500, 500, 40, 3});
+
+	auto json = trace.json();
+	CHECK(json.starts_with("{\"traceEvents\":["));
+	CHECK(json.find("{\"name\":\"parse\",\"cat\":\"load\",\"ph\":\"X\",\"ts\":2000.000,\"dur\":1.500,") !=
+		  std::string::npos);
+	CHECK(json.find("\"args\":{\"bytes\":40,\"count\":3}}\n]}") != std::string::npos);
+}
+
+#if METAMODULE_PATCH_TRACE_THREADS
+TEST_CASE("Trace events can be reported from several threads") {
+	ChromeTraceWriter a;
+	ChromeTraceWriter b;
+	a.install();
+
+	constexpr size_t NumThreads = 4;
+	constexpr size_t NumEvents = 1000;
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < NumThreads; t++) {
+		threads.emplace_back([] {
+			for (size_t i = 0; i < NumEvents; i++)
+				PatchTrace::report({"load", "parse", 1, 1, i, 0});
+		});
+	}
+
+	// Switching writers while events arrive sends each event to exactly one of them
+	for (size_t i = 0; i < 100; i++)
+		(i % 2 ? a : b).install();
+
+	for (auto &t : threads)
+		t.join();
+	a.uninstall();
+	b.uninstall();
+
+	CHECK(a.snapshot().size() + b.snapshot().size() == NumThreads * NumEvents);
+
+	a.clear();
+	PatchTrace::report({"load", "parse", 1, 1, 0, 0});
+	CHECK(a.snapshot().empty());
+}
+#endif
+
+TEST_CASE("A trace callback can replace itself") {
+	struct Switcher {
+		ChromeTraceWriter next;
+		unsigned calls = 0;
+	} switcher;
+
+	set_patch_trace_callback(
+		[](PatchTraceEvent const &, void *context) {
+			auto &s = *static_cast<Switcher *>(context);
+			s.calls++;
+			s.next.install();
+		},
+		&switcher);
+
+	PatchTrace::report({"load", "parse", 1, 1, 0, 0});
+	PatchTrace::report({"load", "emit", 1, 1, 0, 0});
+	switcher.next.uninstall();
+
+	CHECK(switcher.calls == 1);
+	REQUIRE(switcher.next.events().size() == 1);
+	CHECK(std::string_view{switcher.next.events()[0].name} == "emit");
+	CHECK_FALSE(PatchTrace::enabled());
+}
+
+#if defined(METAMODULE_PATCH_TRACE)
+static PatchTraceEvent const *find_event(ChromeTraceWriter const &trace, std::string_view name) {
+	auto &events = trace.events();
+	auto it = std::find_if(events.begin(), events.end(), [=](auto const &e) { return e.name == name; });
+	return it == events.end() ? nullptr : &*it;
+}
+
+TEST_CASE("Loading and saving report each section") {
+	auto pd = generate_patch({.seed = 5, .num_modules = 50});
+
+	ChromeTraceWriter trace;
+	trace.install();
+
+	auto yaml = patch_to_yaml_string(pd);
+
+	REQUIRE(find_event(trace, "patch_to_yaml_string"));
+	REQUIRE(find_event(trace, "emit"));
+	CHECK(find_event(trace, "emit")->bytes == yaml.size());
+	REQUIRE(find_event(trace, "int_cables"));
+	CHECK(find_event(trace, "int_cables")->count == pd.int_cables.size());
+
+	trace.clear();
+	PatchData loaded;
+	REQUIRE(yaml_raw_to_patch(yaml.data(), yaml.size(), loaded));
+	trace.uninstall();
+
+	auto total = find_event(trace, "yaml_raw_to_patch");
+	REQUIRE(total);
+	CHECK(total->bytes == yaml.size());
+
+	auto parse = find_event(trace, "parse");
+	REQUIRE(parse);
+	CHECK(parse->start_ns >= total->start_ns);
+	CHECK(parse->duration_ns <= total->duration_ns);
+
+	auto cables = find_event(trace, "int_cables");
+	REQUIRE(cables);
+	CHECK(std::string_view{cables->category} == "load");
+	CHECK(cables->count == pd.int_cables.size());
+	CHECK(cables->bytes > 0);
+	CHECK(cables->bytes < yaml.size());
+
+	auto states = find_event(trace, "vcvModuleStates");
+	REQUIRE(states);
+	CHECK(states->count == pd.module_states.size());
+
+	// Nothing is reported once the callback is removed
+	trace.clear();
+	yaml = patch_to_yaml_string(pd);
+	CHECK(trace.events().empty());
+}
+#endif
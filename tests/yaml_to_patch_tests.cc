@@ -1,6 +1,9 @@
+#include "../patch_to_yaml.hh"
 #include "../ryml/ryml_serial.hh"
 #include "../yaml_to_patch.hh"
 #include "doctest.h"
+#include "patch/patch_hash.hh"
+#include "patch_generator.hh"
 
 TEST_CASE("Correct header and data produced from yaml") {
 	std::string yamlhdr =
@@ -263,3 +266,250 @@ PatchData:
 	CHECK(!pd.is_module_bypassed(0));
 	CHECK(!pd.is_module_bypassed(2));
 }
+
+TEST_CASE("Module states can be held as views into the source buffer") {
+	std::string yaml = R"(PatchData:
+  patch_name: states
+  module_slugs:
+    0: HubMedium
+    1: Sampler
+  int_cables: []
+  mapped_ins: []
+  mapped_outs: []
+  vcvModuleStates:
+    - module_id: 1
+      data: AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8=
+    - module_id: 2
+      data: |-
+        Line one
+        Line two
+)";
+	std::string copy = yaml;
+
+	MetaModule::PatchData pd_copied;
+	CHECK(yaml_string_to_patch(copy, pd_copied));
+
+	MetaModule::PatchData pd;
+	CHECK(MetaModule::yaml_raw_to_patch(yaml, pd, {.retain_source = true}));
+
+	REQUIRE(pd.module_states.size() == 2);
+	CHECK(pd.module_states[0].data() == pd_copied.module_states[0].data());
+	CHECK(pd.module_states[1].data() == pd_copied.module_states[1].data());
+
+	// Single-line scalars are always left in place by the parser
+	REQUIRE(pd.module_states[0].is_view());
+	auto view = pd.module_states[0].data();
+	CHECK(view.data() >= yaml.data());
+	CHECK(view.data() + view.size() <= yaml.data() + yaml.size());
+
+	// Copies share the view
+	auto copied = pd.module_states[0];
+	CHECK(copied.data().data() == view.data());
+
+	// Modifying a state copies it out of the source buffer first
+	pd.module_states[0].mutable_data() += "==";
+	CHECK_FALSE(pd.module_states[0].is_view());
+	CHECK(pd.module_states[0].data() == std::string(pd_copied.module_states[0].data()) + "==");
+
+	// Assigning state_data replaces the view
+	pd.module_states[1].state_data = "replaced";
+	CHECK(pd.module_states[1].data() == "replaced");
+}
+
+TEST_CASE("Module states of a saved patch load as views") {
+	auto pd = MetaModule::generate_patch({.seed = 15, .num_modules = 20});
+	pd.module_states.push_back({1, "one line"});
+	pd.module_states.push_back({2, "several\nlines\n\nof state"});
+	auto yaml = MetaModule::patch_to_yaml_string(pd);
+
+	MetaModule::PatchData loaded;
+	REQUIRE(MetaModule::yaml_raw_to_patch(yaml, loaded, {.retain_source = true}));
+	REQUIRE(loaded.module_states.size() == pd.module_states.size());
+
+	for (size_t i = 0; i < pd.module_states.size(); i++) {
+		CAPTURE(i);
+		auto const &state = loaded.module_states[i];
+		CHECK(state.is_view());
+		CHECK(state.state_data.empty());
+		CHECK(state.data() == pd.module_states[i].state_data);
+	}
+}
+
+TEST_CASE("Files exceeding the parse limits are rejected") {
+	auto pd = MetaModule::generate_patch({.seed = 9, .num_modules = 100, .state_size = 100});
+	auto yaml = MetaModule::patch_to_yaml_string(pd);
+
+	size_t num_mappings =
+		pd.mapped_ins.size() + pd.mapped_outs.size() + pd.mapped_lights.size() + pd.midi_maps.set.size();
+	for (auto const &set : pd.knob_sets)
+		num_mappings += set.set.size();
+
+	size_t state_bytes = 0;
+	for (auto const &state : pd.module_states)
+		state_bytes += state.data().size();
+
+	auto load = [&](MetaModule::ParseLimits const &limits) {
+		std::string copy = yaml;
+		MetaModule::PatchData loaded;
+		bool ok = MetaModule::yaml_raw_to_patch(copy, loaded, {.limits = limits});
+		// Rejected files leave the patch untouched
+		if (!ok)
+			CHECK(loaded.module_slugs.empty());
+		return ok;
+	};
+
+	CHECK(load({}));
+
+	CHECK(load({.max_file_bytes = yaml.size()}));
+	CHECK_FALSE(load({.max_file_bytes = yaml.size() - 1}));
+
+	CHECK_FALSE(load({.max_nodes = 100}));
+
+	CHECK(load({.max_modules = pd.module_slugs.size()}));
+	CHECK_FALSE(load({.max_modules = pd.module_slugs.size() - 1}));
+
+	CHECK(load({.max_cables = pd.int_cables.size()}));
+	CHECK_FALSE(load({.max_cables = pd.int_cables.size() - 1}));
+
+	CHECK(load({.max_mappings = num_mappings}));
+	CHECK_FALSE(load({.max_mappings = num_mappings - 1}));
+
+	CHECK(load({.max_state_bytes = state_bytes}));
+	CHECK_FALSE(load({.max_state_bytes = state_bytes - 1}));
+}
+
+TEST_CASE("Resumable parser reads a patch in slices") {
+	using enum MetaModule::ResumablePatchParser::Status;
+
+	auto pd = MetaModule::generate_patch({.seed = 10, .num_modules = 100});
+
+	for (bool compact : {false, true}) {
+		CAPTURE(compact);
+		auto yaml = MetaModule::patch_to_yaml_string(pd, {.compact = compact});
+
+		MetaModule::PatchData expected;
+		REQUIRE(MetaModule::yaml_string_to_patch(yaml, expected));
+
+		// One chunk per step
+		MetaModule::PatchData loaded;
+		MetaModule::ResumablePatchParser parser{yaml, loaded, {}, 1024};
+		unsigned num_steps = 0;
+		size_t last_pos = 0;
+		while (parser.step() == InProgress) {
+			CHECK(parser.bytes_read() > last_pos);
+			last_pos = parser.bytes_read();
+			num_steps++;
+		}
+		CHECK(parser.status() == Done);
+		CHECK(num_steps > yaml.size() / 2048);
+		CHECK(patch_hash(loaded) == patch_hash(expected));
+
+		// At least 16kB per step
+		MetaModule::PatchData loaded_budget;
+		MetaModule::ResumablePatchParser parser_budget{yaml, loaded_budget, {}, 1024};
+		unsigned num_budget_steps = 0;
+		while (parser_budget.step(16 * 1024) == InProgress)
+			num_budget_steps++;
+		CHECK(parser_budget.status() == Done);
+		CHECK(num_budget_steps < num_steps);
+		CHECK(patch_hash(loaded_budget) == patch_hash(expected));
+
+		// Limits apply to the totals over all chunks
+		MetaModule::PatchData loaded_limited;
+		MetaModule::ParseLimits limits{.max_cables = pd.int_cables.size() - 1};
+		MetaModule::ResumablePatchParser parser_limited{yaml, loaded_limited, {.limits = limits}, 1024};
+		while (parser_limited.step() == InProgress) {
+		}
+		CHECK(parser_limited.status() == Failed);
+	}
+}
+
+TEST_CASE("Resumable parser reads other layouts in one step") {
+	std::string yaml = R"({"PatchData": {"patch_name": "flow", "module_slugs": {"0": "HubMedium"}, "int_cables": [],
+	  "mapped_ins": [], "mapped_outs": []}})";
+
+	MetaModule::PatchData pd;
+	MetaModule::ResumablePatchParser parser{yaml, pd};
+	CHECK(parser.step() == MetaModule::ResumablePatchParser::Status::Done);
+	CHECK(parser.bytes_read() == yaml.size());
+	CHECK(pd.patch_name == "flow");
+	CHECK(pd.module_slugs.size() == 1);
+
+	MetaModule::PatchData pd2;
+	MetaModule::ResumablePatchParser missing_name{std::string_view{"PatchData:\n  module_slugs: {}\n"}, pd2};
+	CHECK(missing_name.step() == MetaModule::ResumablePatchParser::Status::Failed);
+}
+
+TEST_CASE("Both parsers load files that leave out sections") {
+	using enum MetaModule::ResumablePatchParser::Status;
+
+	auto pd = MetaModule::generate_patch({.seed = 14, .num_modules = 20});
+	auto yaml = MetaModule::patch_to_yaml_string(pd);
+
+	for (auto key : {"module_slugs:", "int_cables:", "mapped_ins:", "mapped_outs:"}) {
+		CAPTURE(key);
+
+		// Rename the section, so it's ignored as an unknown key
+		auto missing = yaml;
+		auto pos = missing.find(key);
+		REQUIRE(pos != std::string::npos);
+		missing.insert(pos, "x_");
+
+		MetaModule::PatchData one_shot;
+		CHECK(MetaModule::yaml_string_to_patch(missing, one_shot));
+		CHECK(one_shot.patch_name == pd.patch_name);
+
+		MetaModule::PatchData chunked;
+		MetaModule::ResumablePatchParser parser{missing, chunked, {}, 256};
+		while (parser.step() == InProgress) {
+		}
+		CHECK(parser.status() == Done);
+		CHECK(chunked.int_cables.size() == one_shot.int_cables.size());
+		CHECK(chunked.mapped_outs.size() == one_shot.mapped_outs.size());
+	}
+}
+
+TEST_CASE("Loading over a patch replaces the sections the file has") {
+	using enum MetaModule::ResumablePatchParser::Status;
+
+	std::string yaml = R"(PatchData:
+  patch_name: 'Over'
+  module_slugs:
+    0: 'HubMedium'
+    1: 'Befaco:EvenVCO'
+  int_cables: []
+  mapped_ins: []
+  mapped_outs: []
+)";
+
+	auto old = MetaModule::generate_patch({.seed = 16, .num_modules = 20});
+	old.suggested_samplerate = 96000;
+	old.suggested_blocksize = 128;
+	old.bypassed_modules = {3, 4};
+
+	auto check_loaded = [&](MetaModule::PatchData const &pd) {
+		CHECK(pd.patch_name.is_equal("Over"));
+		REQUIRE(pd.module_slugs.size() == 2);
+		CHECK(pd.module_slugs[1].is_equal("Befaco:EvenVCO"));
+		CHECK(pd.int_cables.empty());
+
+		// Files without a suggestion load with none
+		CHECK(pd.suggested_samplerate == 0);
+		CHECK(pd.suggested_blocksize == 0);
+
+		// Other sections the file leaves out are kept
+		CHECK(pd.bypassed_modules == old.bypassed_modules);
+		CHECK(pd.knob_sets.size() == old.knob_sets.size());
+	};
+
+	auto one_shot = old;
+	CHECK(MetaModule::yaml_string_to_patch(yaml, one_shot));
+	check_loaded(one_shot);
+
+	auto chunked = old;
+	MetaModule::ResumablePatchParser parser{yaml, chunked, {}, 32};
+	while (parser.step() == InProgress) {
+	}
+	CHECK(parser.status() == Done);
+	check_loaded(chunked);
+}
@@ -1,94 +1,641 @@
 #include "yaml_to_patch.hh"
+#include "patch_trace.hh"
 #include "ryml/ryml_init.hh"
 #include "ryml/ryml_serial.hh"
+#include <algorithm>
+#include <string_view>
 
 namespace MetaModule
 {
 
-bool yaml_raw_to_patch(char *yaml, size_t size, PatchData &pd) {
+namespace
+{
+
+template<auto Member>
+void read_list(ryml::ConstNodeRef const &n, PatchData &pd, std::span<const char>) {
+	auto &v = pd.*Member;
+	auto i = v.size();
+	v.resize(i + n.num_children());
+	for (auto const &child : n.children())
+		child >> v[i++];
+}
+
+template<auto Member>
+void clear_list(PatchData &pd) {
+	(pd.*Member).clear();
+}
+
+template<auto Member>
+void read_value(ryml::ConstNodeRef const &n, PatchData &pd, std::span<const char>) {
+	n >> pd.*Member;
+}
+
+// With a source, states whose data the parser left in it are held as views into it
+void read_states(ryml::ConstNodeRef const &n, PatchData &pd, std::span<const char> source) {
+	auto i = pd.module_states.size();
+	pd.module_states.resize(i + n.num_children());
+	for (auto const &child : n.children())
+		read(child, &pd.module_states[i++], source);
+}
+
+void read_poly_mode(ryml::ConstNodeRef const &n, PatchData &pd, std::span<const char>) {
+	unsigned x = 0xFF;
+	n >> x;
+	if (x <= 3)
+		pd.midi_poly_mode = static_cast<PolyMode>(x);
+}
+
+void read_pitchwheel_range(ryml::ConstNodeRef const &n, PatchData &pd, std::span<const char>) {
+	read_float(n, &pd.midi_pitchwheel_range);
+}
+
+struct PatchField {
+	enum Kind : uint8_t {
+		Value,
+		Section, // reported to the progress callback and traced
+		List,	 // a section read item by item, which may be split between chunks
+	};
+
+	const char *key;
+	Kind kind;
+	bool required;
+	// Lists are appended to, so a list split between chunks can be read piece by piece
+	void (*read)(ryml::ConstNodeRef const &n, PatchData &pd, std::span<const char> source);
+	// Called before a list is first read, so it replaces what pd held
+	void (*clear)(PatchData &pd) = nullptr;
+};
+
+// The keys under PatchData, in the order patch_to_yaml writes them
+constexpr PatchField PatchFields[] = {
+	{"patch_name", PatchField::Value, true, read_value<&PatchData::patch_name>},
+	{"description", PatchField::Value, false, read_value<&PatchData::description>},
+	{"module_slugs", PatchField::List, false, read_list<&PatchData::module_slugs>, clear_list<&PatchData::module_slugs>},
+	{"int_cables", PatchField::List, false, read_list<&PatchData::int_cables>, clear_list<&PatchData::int_cables>},
+	{"mapped_ins", PatchField::List, false, read_list<&PatchData::mapped_ins>, clear_list<&PatchData::mapped_ins>},
+	{"mapped_outs", PatchField::List, false, read_list<&PatchData::mapped_outs>, clear_list<&PatchData::mapped_outs>},
+	{"static_knobs", PatchField::List, false, read_list<&PatchData::static_knobs>, clear_list<&PatchData::static_knobs>},
+	{"mapped_knobs", PatchField::List, false, read_list<&PatchData::knob_sets>, clear_list<&PatchData::knob_sets>},
+	{"midi_maps", PatchField::Section, false, read_value<&PatchData::midi_maps>},
+	{"midi_poly_num", PatchField::Value, false, read_value<&PatchData::midi_poly_num>},
+	{"midi_poly_num_setting", PatchField::Value, false, read_value<&PatchData::midi_poly_num_setting>},
+	{"midi_poly_mode", PatchField::Value, false, read_poly_mode},
+	{"midi_pitchwheel_range", PatchField::Value, false, read_pitchwheel_range},
+	{"mapped_lights", PatchField::List, false, read_list<&PatchData::mapped_lights>, clear_list<&PatchData::mapped_lights>},
+	{"vcvModuleStates", PatchField::List, false, read_states, clear_list<&PatchData::module_states>},
+	{"suggested_samplerate", PatchField::Value, false, read_value<&PatchData::suggested_samplerate>},
+	{"suggested_blocksize", PatchField::Value, false, read_value<&PatchData::suggested_blocksize>},
+	{"bypassed_modules", PatchField::List, false, read_list<&PatchData::bypassed_modules>, clear_list<&PatchData::bypassed_modules>},
+	{"module_aliases", PatchField::List, false, read_list<&PatchData::module_aliases>, clear_list<&PatchData::module_aliases>},
+};
+
+constexpr size_t NumPatchFields = std::size(PatchFields);
+
+PatchField const *find_field(std::string_view key) {
+	for (auto const &field : PatchFields) {
+		if (key == field.key)
+			return &field;
+	}
+	return nullptr;
+}
+
+// Bit per field of PatchFields
+using FieldSet = uint32_t;
+static_assert(NumPatchFields <= sizeof(FieldSet) * 8);
+
+constexpr FieldSet RequiredFields = [] {
+	FieldSet set = 0;
+	for (size_t i = 0; i < NumPatchFields; i++) {
+		if (PatchFields[i].required)
+			set |= FieldSet{1} << i;
+	}
+	return set;
+}();
+
+constexpr FieldSet field_bit(std::string_view key) {
+	for (size_t i = 0; i < NumPatchFields; i++) {
+		if (key == PatchFields[i].key)
+			return FieldSet{1} << i;
+	}
+	return 0;
+}
+
+// Sections a file leaves out keep pd's values, except for the suggested samplerate and
+// blocksize, which files from before they existed don't suggest
+void reset_unread(PatchData &pd, FieldSet fields_read) {
+	if (!(fields_read & field_bit("suggested_samplerate")))
+		pd.suggested_samplerate = 0;
+	if (!(fields_read & field_bit("suggested_blocksize")))
+		pd.suggested_blocksize = 0;
+}
+
+} // namespace
+
+#if defined(METAMODULE_PATCH_TRACE)
+// Bytes of yaml in a top-level section: from its key to the next key
+static size_t source_size(ryml::ConstNodeRef const &n, const char *source_end) {
+	auto const *tree = n.tree();
+	auto next = tree->next_sibling(n.id());
+	auto end = next != ryml::NONE ? tree->key(next).str : source_end;
+	return end - n.key().str;
+}
+#endif
+
+namespace
+{
+
+// Reports each section to the progress callback, and skips the rest once it cancels
+class SectionProgress {
+public:
+	SectionProgress(PatchLoadOptions const &options)
+		: callback{options.on_progress}
+		, context{options.progress_context} {
+	}
+
+	void set_num_sections(ryml::ConstNodeRef const &patchdata) {
+		num_sections = 0;
+		for (auto const &field : PatchFields) {
+			if (field.kind != PatchField::Value && patchdata.has_child(ryml::to_csubstr(field.key)))
+				num_sections++;
+		}
+	}
+
+	bool next(const char *section) {
+		if (callback && !cancelled_ && !callback({section, sections_read, num_sections}, context))
+			cancelled_ = true;
+		if (!cancelled_ && num_sections)
+			sections_read++;
+		return !cancelled_;
+	}
+
+	bool cancelled() const {
+		return cancelled_;
+	}
+
+private:
+	PatchLoadProgressCallback callback;
+	void *context;
+	unsigned sections_read = 0;
+	unsigned num_sections = 0;
+	bool cancelled_ = false;
+};
+
+} // namespace
+
+static size_t num_children(ryml::ConstNodeRef const &n, ryml::csubstr key) {
+	return n.has_child(key) ? n[key].num_children() : 0;
+}
+
+// What ParseLimits bounds, counted in a whole file or summed over the chunks of one
+struct ParseUsage {
+	size_t nodes = 0;
+	size_t modules = 0;
+	size_t cables = 0;
+	size_t mappings = 0;
+	size_t state_bytes = 0;
+};
+
+// Unset limits are skipped, so the default options cost nothing
+static void add_usage(ryml::ConstNodeRef const &patchdata, ParseLimits const &limits, ParseUsage &usage) {
+	if (limits.max_modules != SIZE_MAX)
+		usage.modules += num_children(patchdata, "module_slugs");
+
+	if (limits.max_cables != SIZE_MAX)
+		usage.cables += num_children(patchdata, "int_cables");
+
+	if (limits.max_mappings != SIZE_MAX) {
+		usage.mappings += num_children(patchdata, "mapped_ins") + num_children(patchdata, "mapped_outs") +
+						  num_children(patchdata, "mapped_lights");
+
+		if (patchdata.has_child("mapped_knobs")) {
+			for (auto const &knob_set : patchdata["mapped_knobs"].children()) {
+				if (knob_set.is_map())
+					usage.mappings += num_children(knob_set, "set");
+			}
+		}
+		if (patchdata.has_child("midi_maps") && patchdata["midi_maps"].is_map())
+			usage.mappings += num_children(patchdata["midi_maps"], "set");
+	}
+
+	if (limits.max_state_bytes != SIZE_MAX && patchdata.has_child("vcvModuleStates")) {
+		for (auto const &state : patchdata["vcvModuleStates"].children()) {
+			if (state.is_map() && state.has_child("data"))
+				usage.state_bytes += state["data"].val().size();
+		}
+	}
+}
+
+static bool within_limits(ParseUsage const &usage, ParseLimits const &limits) {
+	return usage.nodes <= limits.max_nodes && usage.modules <= limits.max_modules &&
+		   usage.cables <= limits.max_cables && usage.mappings <= limits.max_mappings &&
+		   usage.state_bytes <= limits.max_state_bytes;
+}
+
+static bool read_patch(char *yaml, size_t size, PatchData &pd, PatchLoadOptions const &options) {
 	RymlInit::init_once();
 
+	if (size > options.limits.max_file_bytes)
+		return false;
+
+	SectionProgress progress{options};
+	if (!progress.next("parse"))
+		return false;
+
+	PATCH_TRACE_BEGIN(total, "load", "yaml_raw_to_patch");
+	PATCH_TRACE_BEGIN(parse, "load", "parse");
+
 	ryml::Tree tree = ryml::parse_in_place(ryml::substr(yaml, size));
 
+	PATCH_TRACE_END(parse, size, tree.size());
+
 	if (tree.num_children(0) == 0)
 		return false;
 
+	if (tree.size() > options.limits.max_nodes)
+		return false;
+
 	ryml::ConstNodeRef root = tree.rootref();
 
 	if (!root.has_child("PatchData"))
 		return false;
 
 	ryml::ConstNodeRef patchdata = root["PatchData"];
+	[[maybe_unused]] const char *source_end = yaml + size;
 
-	if (!patchdata.has_child("patch_name"))
+	ParseUsage usage;
+	add_usage(patchdata, options.limits, usage);
+	if (!within_limits(usage, options.limits))
 		return false;
 
-	patchdata["patch_name"] >> pd.patch_name;
+	for (auto const &field : PatchFields) {
+		if (field.required && !patchdata.has_child(ryml::to_csubstr(field.key)))
+			return false;
+	}
+
+	progress.set_num_sections(patchdata);
+
+	std::span<const char> source;
+	if (options.retain_source)
+		source = {yaml, size};
 
-	if (patchdata.has_child("description"))
-		patchdata["description"] >> pd.description;
+	FieldSet fields_read = 0;
+	for (auto const &field : PatchFields) {
+		auto key = ryml::to_csubstr(field.key);
+		if (!patchdata.has_child(key))
+			continue;
 
-	patchdata["module_slugs"] >> pd.module_slugs;
-	patchdata["int_cables"] >> pd.int_cables;
-	patchdata["mapped_ins"] >> pd.mapped_ins;
+		fields_read |= FieldSet{1} << (&field - PatchFields);
+		auto n = patchdata[key];
+		if (field.clear)
+			field.clear(pd);
 
-	patchdata["mapped_outs"] >> pd.mapped_outs;
-	if (patchdata.has_child("static_knobs"))
-		patchdata["static_knobs"] >> pd.static_knobs;
+		if (field.kind == PatchField::Value) {
+			field.read(n, pd, source);
+			continue;
+		}
 
-	if (patchdata.has_child("mapped_knobs"))
-		patchdata["mapped_knobs"] >> pd.knob_sets;
+		if (!progress.next(field.key))
+			continue;
 
-	if (patchdata.has_child("midi_maps"))
-		patchdata["midi_maps"] >> pd.midi_maps;
+		PATCH_TRACE_BEGIN(trace, "load", field.key);
+		field.read(n, pd, source);
+		PATCH_TRACE_END(trace, source_size(n, source_end), n.num_children());
+	}
+
+	if (progress.cancelled())
+		return false;
 
-	if (patchdata.has_child("midi_poly_num"))
-		patchdata["midi_poly_num"] >> pd.midi_poly_num;
+	reset_unread(pd, fields_read);
+
+	PATCH_TRACE_END(total, size, pd.module_slugs.size());
+	return true;
+}
 
-	if (patchdata.has_child("midi_poly_num_setting"))
-		patchdata["midi_poly_num_setting"] >> pd.midi_poly_num_setting;
+bool yaml_raw_to_patch(char *yaml, size_t size, PatchData &pd) {
+	return read_patch(yaml, size, pd, {});
+}
 
-	if (patchdata.has_child("midi_poly_mode")) {
-		unsigned x = 0xFF;
-		patchdata["midi_poly_mode"] >> x;
-		if (x <= 3)
-			pd.midi_poly_mode = static_cast<PolyMode>(x);
+bool yaml_raw_to_patch(std::span<char> yaml, PatchData &pd) {
+	return yaml_raw_to_patch(yaml.data(), yaml.size_bytes(), pd);
+}
+
+bool yaml_raw_to_patch(std::span<char> yaml, PatchData &pd, PatchLoadOptions const &options) {
+	return read_patch(yaml.data(), yaml.size_bytes(), pd, options);
+}
+
+bool yaml_string_to_patch(std::string yaml, PatchData &pd) {
+	return yaml_raw_to_patch(yaml.data(), yaml.size(), pd);
+}
+
+// JSON is a subset of yaml's flow style, so the yaml parser reads it directly
+bool json_to_patch(std::span<char> json, PatchData &pd) {
+	return json_to_patch(json, pd, {});
+}
+
+bool json_to_patch(std::span<char> json, PatchData &pd, PatchLoadOptions const &options) {
+	// Files often end with a terminator
+	while (!json.empty() && json.back() == '\0')
+		json = json.first(json.size() - 1);
+	return read_patch(json.data(), json.size(), pd, options);
+}
+
+// Resumable parsing
+
+namespace
+{
+
+constexpr size_t NoIndent = SIZE_MAX;
+
+// Indent of a line, or NoIndent if it's blank or a comment
+size_t indent_of(std::string_view line) {
+	auto i = line.find_first_not_of(' ');
+	if (i == std::string_view::npos || line[i] == '\n' || line[i] == '\r' || line[i] == '#')
+		return NoIndent;
+	return i;
+}
+
+// The key of a `key:` line
+std::string_view key_of(std::string_view line, size_t indent) {
+	auto rest = line.substr(indent);
+	auto len = rest.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_");
+	if (len == 0 || len == std::string_view::npos || rest[len] != ':')
+		return {};
+	return rest.substr(0, len);
+}
+
+// True if nothing follows the key's colon, so its value is in the lines below
+bool opens_block(std::string_view line, size_t indent) {
+	auto rest = line.substr(indent + key_of(line, indent).size() + 1);
+	auto i = rest.find_first_not_of(" \r\n");
+	return i == std::string_view::npos || rest[i] == '#';
+}
+
+// Splits a patch file in the block layout patch_to_yaml writes into chunks that
+// each parse as a document of their own, `PatchData:` followed by some of its keys.
+// Chunks end before a top-level key, or before an item of a long list section.
+class PatchChunker {
+public:
+	PatchChunker(std::string_view yaml, size_t chunk_bytes)
+		: yaml{yaml}
+		, chunk_bytes{chunk_bytes} {
+		// Expect `PatchData:` as the first line, after any blank lines, comments or ---
+		size_t p = 0;
+		while (p < yaml.size() && (indent_of(line_at(p)) == NoIndent || line_at(p).starts_with("---")))
+			p += line_at(p).size();
+
+		if (p == yaml.size() || key_of(line_at(p), 0) != "PatchData" || !opens_block(line_at(p), 0))
+			return;
+		p += line_at(p).size();
+
+		for (auto q = p; q < yaml.size(); q += line_at(q).size()) {
+			auto indent = indent_of(line_at(q));
+			if (indent != NoIndent) {
+				data_indent = indent;
+				break;
+			}
+		}
+
+		valid_ = data_indent != NoIndent && data_indent > 0;
+		pos_ = p;
 	}
 
-	if (patchdata.has_child("midi_pitchwheel_range"))
-		patchdata["midi_pitchwheel_range"] >> pd.midi_pitchwheel_range;
+	// False if the file isn't laid out as expected
+	bool valid() const {
+		return valid_;
+	}
 
-	if (patchdata.has_child("mapped_lights"))
-		patchdata["mapped_lights"] >> pd.mapped_lights;
+	size_t pos() const {
+		return pos_;
+	}
 
-	if (patchdata.has_child("vcvModuleStates"))
-		patchdata["vcvModuleStates"] >> pd.module_states;
+	// True once only blank lines, or keys after PatchData, are left
+	bool at_end() const {
+		if (!section_line.empty())
+			return false;
+		for (auto p = pos_; p < yaml.size(); p += line_at(p).size()) {
+			auto indent = indent_of(line_at(p));
+			if (indent != NoIndent)
+				return indent < data_indent;
+		}
+		return true;
+	}
 
-	if (patchdata.has_child("suggested_samplerate"))
-		patchdata["suggested_samplerate"] >> pd.suggested_samplerate;
-	else
-		pd.suggested_samplerate = 0;
+	// Writes the next chunk to out. Returns false at the end.
+	bool next(std::string &out) {
+		if (at_end())
+			return false;
 
-	if (patchdata.has_child("suggested_blocksize"))
-		patchdata["suggested_blocksize"] >> pd.suggested_blocksize;
-	else
-		pd.suggested_blocksize = 0;
+		out = "PatchData:\n";
 
-	if (patchdata.has_child("bypassed_modules"))
-		patchdata["bypassed_modules"] >> pd.bypassed_modules;
+		if (!section_line.empty())
+			return next_slice(out);
 
-	if (patchdata.has_child("module_aliases"))
-		patchdata["module_aliases"] >> pd.module_aliases;
+		auto end = pos_;
+		while (end < yaml.size() && !ends_data(end)) {
+			auto region_end = next_boundary(end, data_indent, true);
+			if (end > pos_ && region_end - pos_ > chunk_bytes)
+				break;
+			if (end == pos_ && region_end - pos_ > chunk_bytes && start_slicing())
+				return next_slice(out);
+			end = region_end;
+		}
 
-	return true;
+		out.append(yaml.substr(pos_, end - pos_));
+		pos_ = end;
+		return true;
+	}
+
+private:
+	std::string_view line_at(size_t p) const {
+		auto end = yaml.find('\n', p);
+		return yaml.substr(p, end == std::string_view::npos ? std::string_view::npos : end + 1 - p);
+	}
+
+	bool ends_data(size_t p) const {
+		auto indent = indent_of(line_at(p));
+		return indent != NoIndent && indent < data_indent;
+	}
+
+	// Start of the first line after the one at `from` that's at or left of indent.
+	// With keys_only, lines at indent must start with a PatchData key: anything else
+	// there is a continuation of a multi-line scalar.
+	size_t next_boundary(size_t from, size_t indent, bool keys_only) const {
+		for (auto p = from + line_at(from).size(); p < yaml.size(); p += line_at(p).size()) {
+			auto line = line_at(p);
+			auto line_indent = indent_of(line);
+			if (line_indent == NoIndent)
+				continue;
+			if (line_indent < indent)
+				return p;
+			if (line_indent == indent && (!keys_only || find_field(key_of(line, indent))))
+				return p;
+		}
+		return yaml.size();
+	}
+
+	// Splits the list section at pos_ between its items
+	bool start_slicing() {
+		auto line = line_at(pos_);
+		auto field = find_field(key_of(line, data_indent));
+		if (!field || field->kind != PatchField::List || !opens_block(line, data_indent) || !line.ends_with('\n'))
+			return false;
+
+		// The first non-blank line after the key
+		auto first_item = next_boundary(pos_, NoIndent - 1, false);
+		if (first_item == yaml.size() || indent_of(line_at(first_item)) <= data_indent)
+			return false;
+
+		item_indent = indent_of(line_at(first_item));
+		section_line = line;
+		pos_ += line.size();
+		return true;
+	}
+
+	bool next_slice(std::string &out) {
+		out.append(section_line);
+
+		auto end = pos_;
+		do {
+			end = next_boundary(end, item_indent, false);
+		} while (end < yaml.size() && indent_of(line_at(end)) == item_indent && end - pos_ < chunk_bytes);
+
+		if (end == yaml.size() || indent_of(line_at(end)) < item_indent)
+			section_line = {};
+
+		out.append(yaml.substr(pos_, end - pos_));
+		pos_ = end;
+		return true;
+	}
+
+	std::string_view yaml;
+	size_t chunk_bytes;
+	size_t pos_ = 0;
+	size_t data_indent = NoIndent;
+	bool valid_ = false;
+
+	// The key line of the section being split, while it's split
+	std::string_view section_line;
+	size_t item_indent = 0;
+};
+
+} // namespace
+
+struct ResumablePatchParser::State {
+	std::span<const char> yaml;
+	PatchData &pd;
+	PatchLoadOptions options;
+	PatchChunker chunker;
+
+	Status status = Status::InProgress;
+	FieldSet fields_read = 0;
+	ParseUsage usage;
+
+	std::string scratch;
+	ryml::Tree tree;
+
+	void read_one_shot() {
+		scratch.assign(yaml.begin(), yaml.end());
+		auto one_shot_options = options;
+		one_shot_options.retain_source = false;
+		one_shot_options.on_progress = nullptr;
+		bool ok = read_patch(scratch.data(), scratch.size(), pd, one_shot_options);
+		status = ok ? Status::Done : Status::Failed;
+	}
+
+	void read_chunk() {
+		if (!chunker.next(scratch)) {
+			finish();
+			return;
+		}
+
+		tree.clear();
+		tree.clear_arena();
+		ryml::parse_in_place(ryml::to_substr(scratch), &tree);
+
+		auto root = tree.rootref();
+		if (!root.is_map() || !root.has_child("PatchData")) {
+			status = Status::Failed;
+			return;
+		}
+
+		// A chunk of only blank lines or comments
+		auto patchdata = root["PatchData"];
+		if (patchdata.is_map()) {
+			usage.nodes += tree.size();
+			add_usage(patchdata, options.limits, usage);
+			if (!within_limits(usage, options.limits)) {
+				status = Status::Failed;
+				return;
+			}
+
+			// Chunks are parsed from scratch, so states are always copied
+			for (auto const &child : patchdata.children()) {
+				if (auto field = find_field({child.key().str, child.key().len})) {
+					auto bit = FieldSet{1} << (field - PatchFields);
+					if (field->clear && !(fields_read & bit))
+						field->clear(pd);
+					field->read(child, pd, {});
+					fields_read |= bit;
+				}
+			}
+		}
+
+		if (chunker.at_end())
+			finish();
+	}
+
+	void finish() {
+		bool has_required = (fields_read & RequiredFields) == RequiredFields;
+		if (has_required)
+			reset_unread(pd, fields_read);
+		status = has_required ? Status::Done : Status::Failed;
+	}
+};
+
+ResumablePatchParser::ResumablePatchParser(std::span<const char> yaml,
+										   PatchData &pd,
+										   PatchLoadOptions const &options,
+										   size_t chunk_bytes)
+	: state{new State{yaml, pd, options, {{yaml.data(), yaml.size()}, chunk_bytes}}} {
+	RymlInit::init_once();
+
+	if (yaml.size() > options.limits.max_file_bytes)
+		state->status = Status::Failed;
 }
 
-bool yaml_raw_to_patch(std::span<char> yaml, PatchData &pd) {
-	return yaml_raw_to_patch(yaml.data(), yaml.size_bytes(), pd);
+ResumablePatchParser::~ResumablePatchParser() = default;
+
+ResumablePatchParser::Status ResumablePatchParser::step(size_t max_bytes) {
+	auto &s = *state;
+	if (s.status != Status::InProgress)
+		return s.status;
+
+	PATCH_TRACE_BEGIN(trace, "load", "step");
+	[[maybe_unused]] auto start = bytes_read();
+
+	if (!s.chunker.valid()) {
+		s.read_one_shot();
+	} else {
+		do {
+			s.read_chunk();
+		} while (s.status == Status::InProgress && bytes_read() - start < max_bytes);
+	}
+
+	PATCH_TRACE_END(trace, bytes_read() - start, 1);
+	return s.status;
 }
 
-bool yaml_string_to_patch(std::string yaml, PatchData &pd) {
-	return yaml_raw_to_patch(yaml.data(), yaml.size(), pd);
+ResumablePatchParser::Status ResumablePatchParser::status() const {
+	return state->status;
+}
+
+size_t ResumablePatchParser::bytes_read() const {
+	if (!state->chunker.valid())
+		return state->status == Status::InProgress ? 0 : state->yaml.size();
+	return state->chunker.pos();
+}
+
+size_t ResumablePatchParser::bytes_total() const {
+	return state->yaml.size();
 }
 
 } // namespace MetaModule
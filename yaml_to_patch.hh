@@ -1,13 +1,99 @@
 #pragma once
 #include "patch/patch.hh"
 #include "patch/patch_data.hh"
+#include <cstdint>
+#include <memory>
 #include <span>
+#include <string>
 
 namespace MetaModule
 {
 
+// Limits for loading untrusted files. A file that exceeds any of them is rejected.
+// max_file_bytes is checked before parsing, and bounds the parser's time and memory.
+// The rest are checked after parsing, before anything is allocated for the PatchData.
+struct ParseLimits {
+	size_t max_file_bytes = SIZE_MAX;
+	size_t max_nodes = SIZE_MAX; // yaml nodes in the parsed tree
+	size_t max_modules = SIZE_MAX;
+	size_t max_cables = SIZE_MAX;
+	size_t max_mappings = SIZE_MAX;	   // knob, MIDI, light and panel jack mappings, in total
+	size_t max_state_bytes = SIZE_MAX; // all module states, in total
+};
+
+struct PatchLoadProgress {
+	const char *section;	// "parse", or the yaml key of the section about to be read
+	unsigned sections_read; // sections read so far
+	unsigned num_sections;	// sections in the file (0 until it's parsed)
+};
+
+// Called before parsing and before each section is read. Returning false cancels the
+// load: no more sections are read and yaml_raw_to_patch() returns false, leaving pd
+// partially filled.
+using PatchLoadProgressCallback = bool (*)(PatchLoadProgress const &progress, void *context);
+
+struct PatchLoadOptions {
+	// Hold module states as views into the yaml buffer instead of copying them
+	// (see ModuleInitState::state_view). The buffer must outlive the PatchData.
+	bool retain_source = false;
+
+	ParseLimits limits{};
+
+	PatchLoadProgressCallback on_progress = nullptr;
+	void *progress_context = nullptr;
+};
+
 bool yaml_raw_to_patch(std::span<char> yaml, PatchData &pd);
+bool yaml_raw_to_patch(std::span<char> yaml, PatchData &pd, PatchLoadOptions const &options);
 bool yaml_raw_to_patch(char *yaml, size_t size, PatchData &pd);
 bool yaml_string_to_patch(std::string yaml, PatchData &pd);
 
+// Reads JSON written by patch_to_json_string(), in place, with the same readers as yaml
+bool json_to_patch(std::span<char> json, PatchData &pd);
+bool json_to_patch(std::span<char> json, PatchData &pd, PatchLoadOptions const &options);
+
+// Parses a patch in slices, for a cooperative scheduler that can't block for a whole
+// parse. Between steps, pd holds the sections read so far.
+//
+// The file is split into chunks of about chunk_bytes, at section boundaries or between
+// the items of a long section, and each step parses whole chunks. This relies on the
+// block layout patch_to_yaml writes; a file laid out any other way is read in one step.
+//
+// Limits are applied to the running totals as chunks are read. Module states are always
+// copied (retain_source is ignored), and on_progress is not called, since the caller
+// drives the parse and can stop stepping at any time.
+class ResumablePatchParser {
+public:
+	enum class Status { InProgress, Done, Failed };
+
+	// yaml must outlive the parser. The list sections of pd are cleared.
+	ResumablePatchParser(std::span<const char> yaml,
+						 PatchData &pd,
+						 PatchLoadOptions const &options = {},
+						 size_t chunk_bytes = 4096);
+	~ResumablePatchParser();
+
+	// Reads one chunk, or chunks until at least max_bytes more of the file are read
+	Status step(size_t max_bytes = 0);
+
+	// Reads chunks while keep_going() returns true, e.g. until a deadline. At least one
+	// chunk is read per call.
+	template<typename F>
+	Status step_while(F &&keep_going) {
+		Status s;
+		do {
+			s = step();
+		} while (s == Status::InProgress && keep_going());
+		return s;
+	}
+
+	Status status() const;
+	size_t bytes_read() const;
+	size_t bytes_total() const;
+
+private:
+	struct State;
+	std::unique_ptr<State> state;
+};
+
 } // namespace MetaModule